@@ -0,0 +1,286 @@
+#pragma once
+
+/*
+ * An Arena< T > holds objects in a handful of large blocks instead of one
+ *  heap allocation per object (as std::list does).
+ *
+ *  - Objects never move, so pointers to them stay valid until they are
+ *    erased (or the arena is cleared or destroyed).
+ *  - Objects are kept in creation order; iterating walks the blocks front to
+ *    back, so it is (mostly) a linear scan of memory.
+ *  - Each slot has a generation number, so a Handle to an object that has
+ *    since been erased can be detected as stale.
+ *  - Erased slots are not reused until clear(), so creation order (e.g.,
+ *    "parents before children" for Scene::Transform) is never disturbed.
+ *
+ * Blocks double in size as the arena grows, so there are only ever a few
+ *  of them -- which keeps pointer-to-handle lookups cheap.
+ *
+ * The interface mirrors the parts of std::list that Scene code uses
+ *  (emplace_back, front, back, size, clear, iteration).
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+template< typename T >
+struct Arena {
+	//A handle names an object by slot index + generation:
+	// (arena.get(handle) returns nullptr once the object has been erased)
+	struct Handle {
+		uint32_t index = -1U;
+		uint32_t generation = 0;
+		bool operator==(Handle const &other) const { return index == other.index && generation == other.generation; }
+		bool operator!=(Handle const &other) const { return !(*this == other); }
+	};
+
+	Arena() = default;
+	Arena(Arena const &other) { *this = other; }
+	Arena(Arena &&other) noexcept { swap(other); }
+	Arena &operator=(Arena const &other) {
+		if (this != &other) {
+			clear();
+			reserve(other.size()); //copies land in (at most) one new block
+			for (T const &value : other) {
+				emplace_back(value);
+			}
+		}
+		return *this;
+	}
+	Arena &operator=(Arena &&other) noexcept {
+		if (this != &other) {
+			Arena temp(std::move(other));
+			swap(temp);
+		}
+		return *this;
+	}
+	~Arena() {
+		clear();
+		for (auto &block : blocks) {
+			std::allocator< T >().deallocate(block.items, block.capacity);
+		}
+	}
+
+	void swap(Arena &other) noexcept {
+		std::swap(blocks, other.blocks);
+		std::swap(generations, other.generations);
+		std::swap(used, other.used);
+		std::swap(live, other.live);
+		std::swap(capacity, other.capacity);
+		std::swap(tail, other.tail);
+	}
+
+	//------- adding / removing -------
+
+	//construct a new object after all existing objects:
+	template< typename... Args >
+	T &emplace_back(Args &&... args) {
+		if (used == capacity) add_block(std::max(MinBlockSize, capacity)); //double the arena's size
+		while (used >= blocks[tail].first + blocks[tail].capacity) ++tail;
+		T *slot = blocks[tail].items + (used - blocks[tail].first);
+		new (slot) T(std::forward< Args >(args)...);
+
+		//odd generations mark live slots:
+		if (used < generations.size()) {
+			assert(generations[used] % 2 == 0);
+			generations[used] += 1;
+		} else {
+			generations.emplace_back(1);
+		}
+		used += 1;
+		live += 1;
+		return *slot;
+	}
+
+	//make sure the next 'count' emplace_back()s don't need more than one new block:
+	void reserve(size_t count) {
+		if (capacity - used < count) add_block(uint32_t(std::max< size_t >(MinBlockSize, count - (capacity - used))));
+	}
+
+	//replace contents with copies of other's objects, each in the *same slot* it occupies in other:
+	// make(T *slot, T const &from) must placement-new a copy of 'from' at 'slot'
+	// (so a pointer into other can be moved to the matching object here with at_index(other.index_of(ptr)))
+	template< typename F >
+	void copy_slots(Arena const &other, F &&make) {
+		clear();
+		if (capacity < other.used) add_block(std::max(MinBlockSize, other.used - capacity));
+		if (generations.size() < other.used) generations.resize(other.used, 0);
+		uint32_t b = 0;
+		for (Block const &from : other.blocks) {
+			for (uint32_t i = from.first; i < from.first + from.capacity && i < other.used; ++i) {
+				if (other.generations[i] % 2 == 0) continue; //(dead slots stay dead)
+				while (i >= blocks[b].first + blocks[b].capacity) ++b;
+				make(blocks[b].items + (i - blocks[b].first), from.items[i - from.first]);
+				generations[i] += 1;
+				used = i + 1;
+				live += 1;
+			}
+		}
+		used = other.used;
+	}
+
+	//destroy an object (its slot is not reused until clear()):
+	void erase(T const *value) {
+		erase(handle_of(value));
+	}
+	void erase(Handle const &handle) {
+		T *value = get(handle);
+		assert(value && "erasing a stale handle");
+		if (!value) return;
+		value->~T();
+		generations[handle.index] += 1;
+		live -= 1;
+	}
+
+	//destroy all objects (keeps blocks around for re-use; all existing handles become stale):
+	void clear() {
+		for (uint32_t b = 0; b < blocks.size(); ++b) {
+			Block const &block = blocks[b];
+			for (uint32_t i = block.first; i < block.first + block.capacity && i < used; ++i) {
+				if (generations[i] % 2 == 1) {
+					block.items[i - block.first].~T();
+					generations[i] += 1;
+				}
+			}
+		}
+		used = 0;
+		live = 0;
+		tail = 0;
+	}
+
+	//------- looking up -------
+
+	size_t size() const { return live; }
+	bool empty() const { return live == 0; }
+
+	//first and last (live) objects:
+	T &front() { assert(!empty()); return *begin(); }
+	T const &front() const { assert(!empty()); return *begin(); }
+	T &back() { return *const_cast< T * >(&static_cast< Arena const & >(*this).back()); }
+	T const &back() const {
+		assert(!empty());
+		uint32_t index = used - 1;
+		while (generations[index] % 2 == 0) --index;
+		return *slot(index);
+	}
+
+	//handle <-> pointer:
+	// (handle_of is a search over the arena's few blocks)
+	Handle handle_of(T const *value) const {
+		uint32_t index = index_of(value);
+		if (index == -1U) return Handle();
+		assert(index < used && generations[index] % 2 == 1 && "handle_of a dead object");
+		return Handle{index, generations[index]};
+	}
+	T *get(Handle const &handle) {
+		return const_cast< T * >(static_cast< Arena const & >(*this).get(handle));
+	}
+	T const *get(Handle const &handle) const {
+		if (handle.index >= used || generations[handle.index] != handle.generation) return nullptr;
+		return slot(handle.index);
+	}
+
+	//slot index <-> pointer:
+	// (no generation checks; useful for moving pointers between arenas with the same layout -- see copy_slots)
+	uint32_t index_of(T const *value) const {
+		for (Block const &block : blocks) {
+			if (!std::less< T const * >()(value, block.items) && std::less< T const * >()(value, block.items + block.capacity)) {
+				return block.first + uint32_t(value - block.items);
+			}
+		}
+		assert(0 && "index_of an object not in this arena");
+		return -1U;
+	}
+	T *at_index(uint32_t index) { return const_cast< T * >(slot(index)); }
+	T const *at_index(uint32_t index) const { return slot(index); }
+
+	//------- iteration -------
+
+	template< typename V > //V is T or T const
+	struct Iterator {
+		typedef std::forward_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef V *pointer;
+		typedef V &reference;
+
+		Iterator() = default;
+		Iterator(Arena const *arena_, uint32_t index_) : arena(arena_), index(index_) { skip_dead(); }
+		//(iterator -> const_iterator conversion:)
+		template< typename W >
+		Iterator(Iterator< W > const &other) : arena(other.arena), block(other.block), index(other.index) { }
+
+		V &operator*() const { return arena->blocks[block].items[index - arena->blocks[block].first]; }
+		V *operator->() const { return &**this; }
+		Iterator &operator++() { ++index; skip_dead(); return *this; }
+		Iterator operator++(int) { Iterator ret = *this; ++*this; return ret; }
+		bool operator==(Iterator const &other) const { return index == other.index; }
+		bool operator!=(Iterator const &other) const { return index != other.index; }
+
+		//handle for the object this iterator points to:
+		Handle handle() const { return Handle{index, arena->generations[index]}; }
+
+		Arena const *arena = nullptr;
+		uint32_t block = 0;
+		uint32_t index = 0;
+
+		void skip_dead() {
+			while (index < arena->used) {
+				Block const &b = arena->blocks[block];
+				if (index >= b.first + b.capacity) ++block;
+				else if (arena->generations[index] % 2 == 1) break;
+				else ++index;
+			}
+		}
+	};
+	typedef Iterator< T > iterator;
+	typedef Iterator< T const > const_iterator;
+
+	iterator begin() { return iterator(this, 0); }
+	iterator end() { return iterator(this, used); }
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, used); }
+
+	//------- internals -------
+
+	static constexpr uint32_t MinBlockSize = 64;
+
+	struct Block {
+		T *items = nullptr;
+		uint32_t first = 0; //index of first slot in block
+		uint32_t capacity = 0;
+	};
+	std::vector< Block > blocks;
+	std::vector< uint32_t > generations; //per slot ever handed out; odd == live
+	uint32_t used = 0; //slots handed out since last clear()
+	uint32_t live = 0; //slots holding live objects
+	uint32_t capacity = 0; //total slots in all blocks
+	uint32_t tail = 0; //block that contains slot 'used' (if any)
+
+	void add_block(uint32_t count) {
+		Block block;
+		block.items = std::allocator< T >().allocate(count);
+		block.first = capacity;
+		block.capacity = count;
+		blocks.emplace_back(block);
+		capacity += count;
+	}
+
+	T const *slot(uint32_t index) const {
+		assert(index < used);
+		//find last block with first <= index:
+		auto b = std::upper_bound(blocks.begin(), blocks.end(), index, [](uint32_t i, Block const &block) { return i < block.first; });
+		assert(b != blocks.begin());
+		--b;
+		return b->items + (index - b->first);
+	}
+};
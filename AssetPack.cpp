@@ -0,0 +1,97 @@
+#include "AssetPack.hpp"
+
+#include "data_path.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+AssetPack::AssetPack(std::string const &filename_) : file(filename_), filename(filename_) {
+	if (file.size < sizeof(Header)) {
+		throw std::runtime_error("Asset pack '" + filename + "' is too small to have a header");
+	}
+	Header header;
+	std::memcpy(&header, file.data, sizeof(header));
+	if (std::string(header.magic, 4) != "pak0") {
+		throw std::runtime_error("Asset pack '" + filename + "' has the wrong magic number");
+	}
+	if (header.slot_count == 0 || (header.slot_count & (header.slot_count - 1)) != 0) {
+		throw std::runtime_error("Asset pack '" + filename + "' has a slot count that isn't a power of two");
+	}
+	uint64_t names_offset = sizeof(Header) + uint64_t(header.slot_count) * sizeof(Slot);
+	if (names_offset + header.names_size > file.size) {
+		throw std::runtime_error("Asset pack '" + filename + "' directory runs past end of file");
+	}
+
+	//(the mapping is page-aligned and the header is 16 bytes, so slots are suitably aligned)
+	slots = reinterpret_cast< Slot const * >(file.data + sizeof(Header));
+	slot_count = header.slot_count;
+	names = file.data + names_offset;
+
+	//check every used slot once, so lookups don't have to:
+	assets.assign(slot_count, Asset{nullptr, 0});
+	uint32_t used = 0;
+	for (uint32_t i = 0; i < slot_count; ++i) {
+		Slot const &slot = slots[i];
+		if (slot.name_end == 0) continue;
+		used += 1;
+		if (!(slot.name_begin < slot.name_end && slot.name_end <= header.names_size)) {
+			throw std::runtime_error("Asset pack '" + filename + "' has a slot with out-of-range name begin/end");
+		}
+		std::string name(names + slot.name_begin, names + slot.name_end);
+		if (slot.hash != hash_name(name)) {
+			throw std::runtime_error("Asset pack '" + filename + "' has the wrong hash for '" + name + "'");
+		}
+		if (slot.offset > file.size || slot.size > file.size - slot.offset) {
+			throw std::runtime_error("Asset pack '" + filename + "' asset '" + name + "' runs past end of file");
+		}
+		assets[i] = Asset{file.data + slot.offset, size_t(slot.size)};
+	}
+	if (used != header.asset_count) {
+		throw std::runtime_error("Asset pack '" + filename + "' has " + std::to_string(used) + " assets in its directory, but its header says " + std::to_string(header.asset_count));
+	}
+}
+
+AssetPack::Asset const *AssetPack::find(std::string const &name) const {
+	uint64_t hash = hash_name(name);
+	uint32_t mask = slot_count - 1;
+	for (uint32_t probe = 0, i = uint32_t(hash) & mask; probe < slot_count; ++probe, i = (i + 1) & mask) {
+		Slot const &slot = slots[i];
+		if (slot.name_end == 0) return nullptr; //empty slot ends the probe sequence
+		if (slot.hash == hash
+		 && slot.name_end - slot.name_begin == name.size()
+		 && std::memcmp(names + slot.name_begin, name.data(), name.size()) == 0) {
+			return &assets[i];
+		}
+	}
+	return nullptr;
+}
+
+AssetPack const *AssetPack::data_pack() {
+	static std::unique_ptr< AssetPack > pack = []() -> std::unique_ptr< AssetPack > {
+		std::string path = data_path("data.pack");
+		if (!std::ifstream(path, std::ios::binary)) return nullptr; //no pack; use loose files
+		std::unique_ptr< AssetPack > ret(new AssetPack(path));
+		std::cout << "Reading game data from '" << path << "' (" << ret->file.size << " bytes)." << std::endl;
+		return ret;
+	}();
+	return pack.get();
+}
+
+AssetPack::Asset const *AssetPack::find_data_path(std::string const &path) {
+	static std::string const prefix = data_path("");
+	if (path.compare(0, prefix.size(), prefix) != 0) return nullptr;
+	AssetPack const *pack = data_pack();
+	if (!pack) return nullptr;
+	return pack->find(path.substr(prefix.size()));
+}
+
+uint64_t AssetPack::hash_name(std::string const &name) {
+	uint64_t hash = 14695981039346656037ULL;
+	for (char c : name) {
+		hash = (hash ^ uint64_t(uint8_t(c))) * 1099511628211ULL;
+	}
+	return hash;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+/*
+ * An AssetPack is a single file holding many asset files, plus a hashed
+ *  directory for finding them by name. The whole pack is mapped at once,
+ *  so loading from it is one open + one mmap, and reading every asset is
+ *  one front-to-back pass over the file.
+ *
+ * Packs are built offline by the pack-assets tool (see pack-assets.cpp).
+ *
+ * The game's pack is 'data.pack' next to the executable. If it exists,
+ *  ChunkFile reads any data_path() that names one of its assets out of the
+ *  pack instead of opening the loose file:
+ *
+ * ChunkFile file(data_path("snow.pnct")); //reads the 'snow.pnct' asset of data.pack, if present
+ *
+ * Pack layout (all integers native-endian, like the chunk format):
+ *  Header
+ *  Slot * slot_count   <-- open-addressed hash table (linear probing) of assets by name
+ *  char * names_size   <-- asset names, referenced by slots
+ *  (padding)
+ *  asset data          <-- each asset starts on an Alignment-byte boundary
+ *
+ */
+
+#include "MappedFile.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct AssetPack {
+	//map a pack file (throws if it can't be read or isn't a valid pack):
+	explicit AssetPack(std::string const &filename);
+
+	struct Asset {
+		char const *data;
+		size_t size;
+	};
+
+	//look up an asset by name (path relative to the pack's root, with '/' separators):
+	// returns nullptr if the pack has no such asset
+	Asset const *find(std::string const &name) const;
+
+	//the game's pack (data_path("data.pack")), or nullptr if there isn't one:
+	// (opened on first call)
+	static AssetPack const *data_pack();
+
+	//look up a path produced by data_path() in the game's pack:
+	// returns nullptr if the path isn't in the data directory, there's no pack, or it has no such asset
+	static Asset const *find_data_path(std::string const &path);
+
+	//-- file format ---
+	enum : uint32_t { Alignment = 4096 }; //asset data alignment (a page, so each asset could be mapped on its own)
+
+	struct Header {
+		char magic[4]; //"pak0"
+		uint32_t slot_count; //power of two
+		uint32_t asset_count;
+		uint32_t names_size;
+	};
+	static_assert(sizeof(Header) == 16, "Header is packed.");
+
+	struct Slot {
+		uint64_t hash; //hash_name() of the name
+		uint32_t name_begin, name_end; //range in names (empty slot: name_end == 0)
+		uint64_t offset; //from start of pack
+		uint64_t size;
+	};
+	static_assert(sizeof(Slot) == 32, "Slot is packed.");
+
+	static uint64_t hash_name(std::string const &name); //(64-bit FNV-1a)
+
+	//-- internals ---
+	MappedFile file;
+	std::string filename;
+	Slot const *slots = nullptr;
+	uint32_t slot_count = 0;
+	char const *names = nullptr;
+	std::vector< Asset > assets; //one per slot (only meaningful for used slots)
+};
@@ -0,0 +1,116 @@
+#include "AssetWatch.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#include <sys/stat.h>
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+//modification time of a file, or 0 if it doesn't exist:
+static int64_t modified_time(std::string const &filename) {
+	#if defined(_WIN32)
+	struct _stat64 info;
+	if (_stat64(filename.c_str(), &info) != 0) return 0;
+	return int64_t(info.st_mtime);
+	#elif defined(__APPLE__)
+	struct stat info;
+	if (stat(filename.c_str(), &info) != 0) return 0;
+	return int64_t(info.st_mtimespec.tv_sec) * 1000000000 + info.st_mtimespec.tv_nsec;
+	#else
+	struct stat info;
+	if (stat(filename.c_str(), &info) != 0) return 0;
+	return int64_t(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+	#endif
+}
+
+AssetWatch::AssetWatch() {
+	#if defined(__linux__)
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd == -1) {
+		std::cerr << "NOTE: couldn't start inotify (errno " << errno << "); polling for asset changes instead." << std::endl;
+	}
+	#endif
+	last_poll = std::chrono::steady_clock::now();
+}
+
+AssetWatch::~AssetWatch() {
+	#if defined(__linux__)
+	if (inotify_fd != -1) close(inotify_fd);
+	#endif
+}
+
+void AssetWatch::add(std::string const &filename) {
+	File file;
+	file.filename = filename;
+	size_t slash = filename.find_last_of("/\\");
+	if (slash == std::string::npos) {
+		file.directory = ".";
+		file.name = filename;
+	} else {
+		file.directory = filename.substr(0, slash);
+		file.name = filename.substr(slash + 1);
+	}
+	file.modified = modified_time(filename);
+
+	#if defined(__linux__)
+	if (inotify_fd != -1) {
+		auto f = std::find_if(watched_directories.begin(), watched_directories.end(), [&](auto const &wd) { return wd.second == file.directory; });
+		if (f == watched_directories.end()) {
+			int wd = inotify_add_watch(inotify_fd, file.directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+			if (wd == -1) {
+				std::cerr << "WARNING: couldn't watch directory '" << file.directory << "' (errno " << errno << ") for changes to '" << filename << "'." << std::endl;
+			} else {
+				watched_directories.emplace_back(wd, file.directory);
+			}
+		}
+	}
+	#endif
+
+	files.emplace_back(file);
+}
+
+std::vector< std::string > AssetWatch::changed() {
+	std::vector< std::string > ret;
+	auto note = [&ret](std::string const &filename) {
+		if (std::find(ret.begin(), ret.end(), filename) == ret.end()) ret.emplace_back(filename);
+	};
+
+	#if defined(__linux__)
+	if (inotify_fd != -1) {
+		alignas(struct inotify_event) char buffer[4096];
+		while (true) {
+			ssize_t got = read(inotify_fd, buffer, sizeof(buffer));
+			if (got <= 0) break; //(EAGAIN: nothing more to read)
+			for (char const *at = buffer; at < buffer + got; ) {
+				struct inotify_event const *event = reinterpret_cast< struct inotify_event const * >(at);
+				at += sizeof(struct inotify_event) + event->len;
+				if (event->len == 0) continue;
+				std::string name = event->name; //(nul-terminated, maybe with extra padding)
+				for (auto const &wd : watched_directories) {
+					if (wd.first != event->wd) continue;
+					for (File const &file : files) {
+						if (file.directory == wd.second && file.name == name) note(file.filename);
+					}
+				}
+			}
+		}
+		return ret;
+	}
+	#endif
+
+	auto now = std::chrono::steady_clock::now();
+	if (now - last_poll < PollInterval) return ret;
+	last_poll = now;
+	for (File &file : files) {
+		int64_t modified = modified_time(file.filename);
+		if (modified != file.modified) {
+			file.modified = modified;
+			if (modified != 0) note(file.filename); //(ignore files disappearing; they'll be noticed when they come back)
+		}
+	}
+	return ret;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+/*
+ * An AssetWatch notices when files change on disk (e.g., when an asset is
+ *  re-exported from Blender while the game is running).
+ *
+ * On Linux it uses inotify on each watched file's directory, so a file that is
+ *  replaced (written to a temporary name and renamed over) is noticed as well
+ *  as one that is rewritten in place. Elsewhere (or if inotify isn't
+ *  available) it compares modification times, at most every PollInterval.
+ *
+ * //typical use (see HotReload.hpp):
+ * AssetWatch watch;
+ * watch.add(data_path("snow.pnct"));
+ * //...once per frame:
+ * for (std::string const &filename : watch.changed()) { ... }
+ *
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct AssetWatch {
+	AssetWatch();
+	~AssetWatch();
+
+	AssetWatch(AssetWatch const &) = delete;
+	AssetWatch &operator=(AssetWatch const &) = delete;
+
+	//start watching a file (which need not exist yet):
+	void add(std::string const &filename);
+
+	//files (as passed to add) that changed since the last call, each listed once; never blocks:
+	std::vector< std::string > changed();
+
+	//-- internals ---
+	struct File {
+		std::string filename;
+		std::string directory, name; //(split at the last separator)
+		int64_t modified = 0; //modification time as of the last poll (polling only)
+	};
+	std::vector< File > files;
+
+	int inotify_fd = -1; //(-1 => polling)
+	std::vector< std::pair< int, std::string > > watched_directories; //inotify watch descriptor, directory
+
+	static constexpr std::chrono::milliseconds PollInterval = std::chrono::milliseconds(500);
+	std::chrono::steady_clock::time_point last_poll;
+};
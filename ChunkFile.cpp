@@ -0,0 +1,184 @@
+#include "ChunkFile.hpp"
+#include "read_write_chunk.hpp"
+#include "AssetPack.hpp"
+#include "chunk_compression.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <atomic>
+#include <thread>
+
+ChunkFile::ChunkFile(std::string const &filename_) : filename(filename_) {
+	//files inside the game's asset pack are read straight out of the pack's mapping:
+	if (AssetPack::Asset const *asset = AssetPack::find_data_path(filename)) {
+		bytes = asset->data;
+		size = asset->size;
+	} else {
+		mapped.reset(new MappedFile(filename));
+		bytes = mapped->data;
+		size = mapped->size;
+	}
+	load_chunk_list();
+}
+
+ChunkFile::~ChunkFile() {
+}
+
+bool ChunkFile::peek(std::string const &magic) const {
+	assert(magic.size() == 4);
+	return next < chunks.size() && std::string(chunks[next].magic, 4) == magic;
+}
+
+uint32_t ChunkFile::lookup(std::string const &magic) const {
+	assert(magic.size() == 4);
+	for (uint32_t i = 0; i < chunks.size(); ++i) {
+		if (std::string(chunks[i].magic, 4) == magic) return i;
+	}
+	return -1U;
+}
+
+void ChunkFile::load_chunk_list() {
+	//note compressed chunks, stripping the flag from their magic:
+	auto add_chunk = [this](Chunk chunk) {
+		if (uint8_t(chunk.magic[0]) & CompressedChunkFlag) {
+			chunk.magic[0] = char(uint8_t(chunk.magic[0]) & ~CompressedChunkFlag);
+			chunk.compressed = true;
+			size_t raw_size = compressed_chunk_raw_size(bytes + chunk.payload, chunk.size);
+			if (raw_size > 0xffffffffu) throw std::runtime_error("Compressed chunk '" + std::string(chunk.magic, 4) + "' in '" + filename + "' is too large");
+			chunk.raw_size = uint32_t(raw_size);
+		} else {
+			chunk.raw_size = chunk.size;
+		}
+		chunks.emplace_back(chunk);
+	};
+
+	struct ChunkHeader {
+		char magic[4];
+		uint32_t size;
+	};
+	static_assert(sizeof(ChunkHeader) == 8, "header is packed");
+
+	if (size > 0xffffffffu) {
+		throw std::runtime_error("Chunk file '" + filename + "' is too large (chunk offsets are 32 bits)");
+	}
+
+	//header at 'offset', or throw:
+	auto header_at = [this](size_t offset) {
+		if (offset > size || size - offset < sizeof(ChunkHeader)) {
+			throw std::runtime_error("Chunk header at " + std::to_string(offset) + " is past the end of '" + filename + "'");
+		}
+		ChunkHeader header;
+		std::memcpy(&header, bytes + offset, sizeof(header));
+		if (size - offset - sizeof(ChunkHeader) < header.size) {
+			throw std::runtime_error("Chunk '" + std::string(header.magic, 4) + "' in '" + filename + "' runs past end of file");
+		}
+		return header;
+	};
+
+	if (size >= sizeof(ChunkHeader) && std::string(bytes, 4) == "toc0") {
+		//list of chunks is given up front:
+		ChunkHeader toc = header_at(0);
+		if (toc.size % sizeof(ChunkTocEntry) != 0) {
+			throw std::runtime_error("Size of 'toc0' chunk in '" + filename + "' not divisible by entry size");
+		}
+		chunks.reserve(toc.size / sizeof(ChunkTocEntry));
+		for (size_t at = sizeof(ChunkHeader); at < sizeof(ChunkHeader) + toc.size; at += sizeof(ChunkTocEntry)) {
+			ChunkTocEntry entry;
+			std::memcpy(&entry, bytes + at, sizeof(entry));
+			//make sure the entry agrees with the chunk's own header:
+			ChunkHeader header = header_at(entry.offset);
+			if (std::memcmp(header.magic, entry.magic, 4) != 0 || header.size != entry.size) {
+				throw std::runtime_error("Entry for '" + std::string(entry.magic, 4) + "' in 'toc0' chunk of '" + filename + "' doesn't match chunk at its offset");
+			}
+			Chunk chunk;
+			std::memcpy(chunk.magic, entry.magic, 4);
+			chunk.payload = entry.offset + uint32_t(sizeof(ChunkHeader));
+			chunk.size = entry.size;
+			add_chunk(chunk);
+		}
+	} else {
+		//hop from header to header:
+		size_t offset = 0;
+		while (size - offset >= sizeof(ChunkHeader)) {
+			ChunkHeader header;
+			std::memcpy(&header, bytes + offset, sizeof(header));
+			if (size - offset - sizeof(ChunkHeader) < header.size) break; //(not a whole chunk; counted as trailing)
+			Chunk chunk;
+			std::memcpy(chunk.magic, header.magic, 4);
+			chunk.payload = uint32_t(offset + sizeof(ChunkHeader));
+			chunk.size = header.size;
+			add_chunk(chunk);
+			offset = chunk.payload + size_t(chunk.size);
+		}
+		trailing_bytes = size - offset;
+	}
+}
+
+char *ChunkFile::allocate(size_t count) {
+	owned.emplace_back(new std::max_align_t[(count + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t)]);
+	return reinterpret_cast< char * >(owned.back().get());
+}
+
+char const *ChunkFile::realign(Chunk const &chunk) {
+	char *copy = allocate(chunk.size);
+	if (chunk.size) std::memcpy(copy, bytes + chunk.payload, chunk.size);
+	realigned_bytes += chunk.size;
+	return copy;
+}
+
+void ChunkFile::decompress(Chunk &chunk) {
+	assert(chunk.compressed && !chunk.decompressed);
+	char *out = allocate(chunk.raw_size);
+	try {
+		decompress_chunk_payload(bytes + chunk.payload, chunk.size, out);
+	} catch (std::runtime_error &e) {
+		throw std::runtime_error("Chunk '" + std::string(chunk.magic, 4) + "' in '" + filename + "': " + e.what());
+	}
+	chunk.decompressed = out;
+	decompressed_bytes += chunk.raw_size;
+}
+
+void ChunkFile::decompress_all() {
+	std::vector< Chunk * > todo;
+	size_t todo_bytes = 0;
+	for (Chunk &chunk : chunks) {
+		if (chunk.compressed && !chunk.decompressed) {
+			todo.emplace_back(&chunk);
+			todo_bytes += chunk.raw_size;
+		}
+	}
+	//starting a thread costs about as much as decompressing tens of kilobytes, so small files go one chunk at a time:
+	uint32_t thread_count = std::min< uint32_t >(uint32_t(todo.size()), std::max(1U, std::thread::hardware_concurrency()));
+	if (thread_count <= 1 || todo_bytes < ParallelDecompressBytes) {
+		for (Chunk *chunk : todo) decompress(*chunk);
+		return;
+	}
+
+	//allocate up front (owned / decompressed_bytes aren't thread-safe), then decompress in parallel, biggest chunks first:
+	std::sort(todo.begin(), todo.end(), [](Chunk const *a, Chunk const *b) { return a->raw_size > b->raw_size; });
+	std::vector< char * > outs;
+	for (Chunk *chunk : todo) outs.emplace_back(allocate(chunk->raw_size));
+	std::vector< std::string > errors(todo.size());
+	std::atomic< size_t > next_todo(0);
+	auto work = [&]() {
+		for (size_t i = next_todo++; i < todo.size(); i = next_todo++) {
+			try {
+				decompress_chunk_payload(bytes + todo[i]->payload, todo[i]->size, outs[i]);
+			} catch (std::runtime_error &e) {
+				errors[i] = e.what();
+			}
+		}
+	};
+	std::vector< std::thread > threads;
+	for (uint32_t t = 1; t < thread_count; ++t) threads.emplace_back(work);
+	work(); //(this thread takes a share too)
+	for (auto &thread : threads) thread.join();
+
+	for (size_t i = 0; i < todo.size(); ++i) {
+		if (!errors[i].empty()) {
+			throw std::runtime_error("Chunk '" + std::string(todo[i]->magic, 4) + "' in '" + filename + "': " + errors[i]);
+		}
+		todo[i]->decompressed = outs[i];
+		decompressed_bytes += todo[i]->raw_size;
+	}
+}
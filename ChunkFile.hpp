@@ -0,0 +1,183 @@
+#pragma once
+
+/*
+ * A ChunkFile maps a file of chunks (the format written by write_chunk; see
+ *  read_write_chunk.hpp) into memory and hands out typed views of the chunk
+ *  payloads, which point straight into the mapping.
+ *
+ * Unlike read_chunk, nothing is zero-filled or copied: data can go from the
+ *  page cache straight to glBufferData (or be parsed in place).
+ *
+ * Chunks can be read in file order (read / peek, like read_chunk) or looked
+ *  up by magic number (find / has), which skips everything else -- so a file
+ *  can carry chunks a given reader doesn't know or care about.
+ *
+ * //typical use (see MeshBuffer::MeshBuffer):
+ * ChunkFile file(filename);
+ * ChunkFile::Span< Vertex > data = file.find< Vertex >("pnct");
+ * if (file.has("idx1")) { auto elements = file.find< uint32_t >("idx1"); ... }
+ * glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(Vertex), data.data(), GL_STATIC_DRAW);
+ *
+ * The list of chunks comes from the file's 'toc0' chunk if it starts with
+ *  one (see ChunkTocWriter in read_write_chunk.hpp); otherwise, it is built
+ *  by hopping from header to header when the file is opened, which only
+ *  touches the pages holding headers.
+ *
+ * Every read checks that the chunk is in bounds and that its size is a whole
+ *  number of elements; failures throw std::runtime_error.
+ *
+ * Every read also checks that the payload is aligned for the element type.
+ *  Chunks without a toc aren't padded (e.g., an odd-length 'str0' misaligns
+ *  every chunk after it), so a misaligned payload is copied once into aligned
+ *  storage owned by the ChunkFile instead; realigned_bytes counts such copies.
+ *
+ * Compressed chunks (see chunk_compression.hpp) are decompressed into
+ *  storage owned by the ChunkFile the first time they are read; call
+ *  decompress_all() first to decompress all of them in parallel instead.
+ *
+ * Files that are in the game's asset pack (see AssetPack.hpp) are read from
+ *  the pack's mapping instead of being opened separately.
+ *
+ * Spans are only valid while their ChunkFile is alive.
+ *
+ */
+
+#include "MappedFile.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <memory>
+#include <string>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+struct ChunkFile {
+	//map the whole file (throws if it can't be opened or mapped):
+	// (or, if 'filename' is a data_path() inside the game's asset pack, use the pack's copy)
+	explicit ChunkFile(std::string const &filename);
+	~ChunkFile();
+
+	ChunkFile(ChunkFile const &) = delete;
+	ChunkFile &operator=(ChunkFile const &) = delete;
+
+	//read-only, bounds-checked view of an array of T:
+	template< typename T >
+	struct Span {
+		T const *begin_ = nullptr;
+		T const *end_ = nullptr;
+
+		T const *data() const { return begin_; }
+		size_t size() const { return size_t(end_ - begin_); }
+		bool empty() const { return begin_ == end_; }
+		T const *begin() const { return begin_; }
+		T const *end() const { return end_; }
+		T const &operator[](size_t i) const { assert(i < size()); return begin_[i]; }
+	};
+
+	//does the next chunk have this magic number? (for optional chunks)
+	bool peek(std::string const &magic) const;
+
+	//read the next chunk, which must have this magic number, as an array of T:
+	template< typename T >
+	Span< T > read(std::string const &magic);
+
+	//does any chunk have this magic number?
+	bool has(std::string const &magic) const { return lookup(magic) != -1U; }
+
+	//read the (first) chunk with this magic number, wherever it is, as an array of T:
+	// (throws if there is no such chunk; doesn't change what read() reads next)
+	template< typename T >
+	Span< T > find(std::string const &magic);
+
+	//has every chunk been read by read()?
+	bool at_end() const { return next == chunks.size(); }
+
+	//decompress every compressed chunk now, spreading chunks over several threads if there is enough data to be worth it:
+	// (otherwise, each is decompressed when first read)
+	void decompress_all();
+	enum : size_t { ParallelDecompressBytes = 256 * 1024 };
+
+	std::string filename; //(for error messages)
+	size_t realigned_bytes = 0; //bytes copied because their chunk was misaligned (ideally zero)
+	size_t trailing_bytes = 0; //bytes after the last chunk that don't make up a chunk (files without a toc only)
+	size_t decompressed_bytes = 0; //bytes produced by decompressing chunks
+
+	//-- internals ---
+	std::unique_ptr< MappedFile > mapped; //(null if reading from the asset pack)
+	char const *bytes = nullptr; //start of file data
+	size_t size = 0; //file size in bytes
+
+	struct Chunk {
+		char magic[4]; //(without CompressedChunkFlag)
+		uint32_t payload; //offset of data from start of file
+		uint32_t size; //bytes of data (as stored in the file)
+		bool compressed = false;
+		uint32_t raw_size = 0; //bytes of data once decompressed (same as size if not compressed)
+		char const *decompressed = nullptr; //(set once a compressed chunk is decompressed)
+	};
+	std::vector< Chunk > chunks; //in file order (not including any toc)
+	size_t next = 0; //index of the chunk read() will read
+
+	uint32_t lookup(std::string const &magic) const; //index in chunks, or -1U
+	void load_chunk_list(); //fills 'chunks' (called by constructor)
+
+	//view of a chunk's payload as T's:
+	template< typename T >
+	Span< T > view(Chunk &chunk);
+
+	//copies of misaligned or compressed payloads:
+	std::vector< std::unique_ptr< std::max_align_t[] > > owned;
+	char *allocate(size_t bytes);
+	char const *realign(Chunk const &chunk);
+	void decompress(Chunk &chunk);
+
+};
+
+template< typename T >
+ChunkFile::Span< T > ChunkFile::view(Chunk &chunk) {
+	static_assert(std::is_trivially_copyable< T >::value, "Chunk elements are read as raw bytes.");
+	static_assert(alignof(T) <= alignof(std::max_align_t), "Chunk elements can't be over-aligned.");
+
+	std::string magic(chunk.magic, 4);
+	if (chunk.raw_size % sizeof(T) != 0) {
+		throw std::runtime_error("Size of chunk '" + magic + "' in '" + filename + "' not divisible by element size");
+	}
+	char const *at;
+	if (chunk.compressed) {
+		if (!chunk.decompressed) decompress(chunk);
+		at = chunk.decompressed; //(max_align_t-aligned)
+	} else {
+		at = bytes + chunk.payload;
+		if (reinterpret_cast< uintptr_t >(at) % alignof(T) != 0) at = realign(chunk);
+	}
+
+	Span< T > ret;
+	ret.begin_ = reinterpret_cast< T const * >(at);
+	ret.end_ = ret.begin_ + chunk.raw_size / sizeof(T);
+	return ret;
+}
+
+template< typename T >
+ChunkFile::Span< T > ChunkFile::read(std::string const &magic) {
+	assert(magic.size() == 4);
+	if (next == chunks.size()) {
+		throw std::runtime_error("Failed to read chunk header ('" + magic + "') from '" + filename + "'");
+	}
+	Chunk &chunk = chunks[next];
+	if (std::string(chunk.magic, 4) != magic) {
+		throw std::runtime_error("Unexpected magic number in chunk (wanted '" + magic + "', got '" + std::string(chunk.magic, 4) + "') in '" + filename + "'");
+	}
+	next += 1;
+	return view< T >(chunk);
+}
+
+template< typename T >
+ChunkFile::Span< T > ChunkFile::find(std::string const &magic) {
+	uint32_t index = lookup(magic);
+	if (index == -1U) {
+		throw std::runtime_error("No '" + magic + "' chunk in '" + filename + "'");
+	}
+	return view< T >(chunks[index]);
+}
@@ -1,6 +1,7 @@
 #include "DrawLines.hpp"
 #include "PathFont.hpp"
 #include "ColorProgram.hpp"
+#include "FrameProfiler.hpp"
 
 #include "gl_errors.hpp"
 
@@ -135,6 +136,8 @@ void DrawLines::draw_text(std::string const &text, glm::vec3 const &anchor_in, g
 DrawLines::~DrawLines() {
 	if (attribs.empty()) return;
 
+	FrameProfiler::GpuScope profile(FrameProfiler::GpuLines); //(GPU time shows in the frame time overlay)
+
 	//based on DrawSprites.cpp :
 
 	//upload vertices to vertex_buffer:
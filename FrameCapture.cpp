@@ -0,0 +1,208 @@
+#include "FrameCapture.hpp"
+
+#include "gl_errors.hpp"
+#include "load_save_png.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+
+FrameCapture::FrameCapture() {
+	//PNG encoding is slow (tens of milliseconds per frame), so sequences need several encoders to keep up:
+	encoder_count = std::max(2U, std::thread::hardware_concurrency()) - 1U;
+	max_queued = 2 * encoder_count + 1;
+}
+
+void FrameCapture::start_encoders() {
+	if (!encoders.empty()) return;
+	encoders.reserve(encoder_count);
+	for (uint32_t i = 0; i < encoder_count; ++i) {
+		encoders.emplace_back(&FrameCapture::encode_thread, this);
+	}
+}
+
+FrameCapture::~FrameCapture() {
+	//(if finish() wasn't called, readbacks still in flight are lost -- there may be no context to collect them with)
+	{
+		std::unique_lock< std::mutex > lock(encode_mutex);
+		quit = true;
+	}
+	encode_cv.notify_all();
+	for (auto &thread : encoders) {
+		if (thread.joinable()) thread.join();
+	}
+}
+
+void FrameCapture::screenshot(std::string const &filename) {
+	std::cout << "Saving screenshot to '" << filename << "'." << std::endl;
+	start_encoders();
+	pending_screenshot = filename;
+}
+
+void FrameCapture::start_sequence(std::string const &prefix) {
+	if (sequence) stop_sequence();
+	std::cout << "Saving frames to '" << prefix << "000000.png', ..." << std::endl;
+	start_encoders();
+	sequence = true;
+	sequence_prefix = prefix;
+	sequence_frame = 0;
+	sequence_skipped = 0;
+}
+
+void FrameCapture::stop_sequence() {
+	if (!sequence) return;
+	sequence = false;
+	std::cout << "Saved " << (sequence_frame - sequence_skipped) << " frames to '" << sequence_prefix << "*.png'";
+	if (sequence_skipped) std::cout << " (skipped " << sequence_skipped << " while encoding fell behind)";
+	std::cout << "." << std::endl;
+}
+
+void FrameCapture::capture(glm::uvec2 const &drawable_size) {
+	//collect finished readbacks (without waiting), oldest first:
+	for (uint32_t i = 0; i < RingSize; ++i) {
+		Readback &readback = ring[(next_readback + i) % RingSize];
+		if (!readback.fence) continue;
+		GLenum status = glClientWaitSync(readback.fence, 0, 0);
+		if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) collect(readback);
+	}
+
+	std::vector< std::string > filenames;
+	if (!pending_screenshot.empty()) {
+		filenames.emplace_back(pending_screenshot);
+		pending_screenshot.clear();
+	}
+	if (sequence) {
+		uint32_t in_flight = 0;
+		for (auto const &readback : ring) {
+			if (readback.fence) in_flight += 1;
+		}
+		size_t waiting;
+		{
+			std::unique_lock< std::mutex > lock(encode_mutex);
+			waiting = encode_queue.size() + in_flight;
+		}
+		if (waiting < max_queued) {
+			std::ostringstream name;
+			name << sequence_prefix << std::setw(6) << std::setfill('0') << sequence_frame << ".png";
+			filenames.emplace_back(name.str());
+		} else {
+			sequence_skipped += 1;
+		}
+		sequence_frame += 1;
+	}
+	if (filenames.empty() || drawable_size.x == 0 || drawable_size.y == 0) return;
+
+	Readback &readback = ring[next_readback];
+	next_readback = (next_readback + 1) % RingSize;
+	if (readback.fence) collect(readback); //(ring is full; wait for the oldest)
+
+	size_t bytes = size_t(drawable_size.x) * size_t(drawable_size.y) * 4;
+	if (readback.buffer == 0) glGenBuffers(1, &readback.buffer);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+	if (readback.allocated != bytes) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+		readback.allocated = bytes;
+	}
+
+	//copy into the buffer (returns without waiting for the copy to happen):
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glReadBuffer(framebuffer ? GL_COLOR_ATTACHMENT0 : GL_BACK);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, drawable_size.x, drawable_size.y, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	readback.size = drawable_size;
+	readback.filenames = std::move(filenames);
+
+	GL_ERRORS();
+}
+
+void FrameCapture::collect(Readback &readback) {
+	assert(readback.fence);
+	while (true) {
+		GLenum status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ULL);
+		if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) break;
+		if (status == GL_WAIT_FAILED) {
+			std::cerr << "WARNING: waiting for frame readback failed." << std::endl;
+			break;
+		}
+	}
+	glDeleteSync(readback.fence);
+	readback.fence = 0;
+
+	Encode encode;
+	encode.filenames = std::move(readback.filenames);
+	encode.size = readback.size;
+	encode.data.resize(size_t(readback.size.x) * size_t(readback.size.y));
+
+	size_t bytes = encode.data.size() * sizeof(glm::u8vec4);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+	void const *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+	if (mapped) {
+		std::memcpy(encode.data.data(), mapped, bytes);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	GL_ERRORS();
+
+	if (!mapped) {
+		std::cerr << "WARNING: couldn't map frame readback; not saving '" << encode.filenames[0] << "'." << std::endl;
+		return;
+	}
+
+	{
+		std::unique_lock< std::mutex > lock(encode_mutex);
+		encode_queue.emplace_back(std::move(encode));
+	}
+	encode_cv.notify_one();
+}
+
+void FrameCapture::finish() {
+	if (sequence) stop_sequence();
+
+	//collect remaining readbacks, oldest first:
+	for (uint32_t i = 0; i < RingSize; ++i) {
+		Readback &readback = ring[(next_readback + i) % RingSize];
+		if (readback.fence) collect(readback);
+		if (readback.buffer) {
+			glDeleteBuffers(1, &readback.buffer);
+			readback.buffer = 0;
+			readback.allocated = 0;
+		}
+	}
+
+	//encoders finish everything queued before they quit:
+	{
+		std::unique_lock< std::mutex > lock(encode_mutex);
+		quit = true;
+	}
+	encode_cv.notify_all();
+	for (auto &thread : encoders) {
+		if (thread.joinable()) thread.join();
+	}
+}
+
+void FrameCapture::encode_thread() {
+	while (true) {
+		Encode encode;
+		{
+			std::unique_lock< std::mutex > lock(encode_mutex);
+			encode_cv.wait(lock, [this]() { return quit || !encode_queue.empty(); });
+			if (encode_queue.empty()) break; //(quit, and nothing left to do)
+			encode = std::move(encode_queue.front());
+			encode_queue.pop_front();
+		}
+
+		//the framebuffer's alpha isn't meaningful for a screenshot:
+		for (auto &px : encode.data) {
+			px.a = 0xff;
+		}
+		for (auto const &filename : encode.filenames) {
+			save_png(filename, encode.size, encode.data.data(), LowerLeftOrigin);
+		}
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+/*
+ * FrameCapture saves screenshots (and sequences of frames) without stalling the game.
+ *
+ * Each captured frame is copied into a pixel buffer object (glReadPixels into a
+ *  GL_PIXEL_PACK_BUFFER returns right away); the pixels are collected from the
+ *  buffer a frame or two later, once the GPU is done with them, and handed to
+ *  worker threads that set alpha and encode the PNG.
+ *
+ * //once there is an OpenGL context:
+ * FrameCapture capture;
+ * //...when the screenshot key is pressed:
+ * capture.screenshot("screenshot.png");
+ * //...every frame, after drawing and before swapping:
+ * capture.capture(drawable_size);
+ * //...before the context is destroyed:
+ * capture.finish();
+ *
+ * In a sequence (start_sequence), every frame is saved as prefix000000.png, prefix000001.png, ...
+ *  If encoding falls too far behind, frames are skipped (their numbers are skipped too, so gaps
+ *  are visible) rather than slowing the game down.
+ *
+ */
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct FrameCapture {
+	FrameCapture(); //(needs an OpenGL context)
+	~FrameCapture(); //(call finish() first, while the context still exists)
+
+	FrameCapture(FrameCapture const &) = delete;
+	FrameCapture &operator=(FrameCapture const &) = delete;
+
+	//save the next frame captured to 'filename':
+	void screenshot(std::string const &filename);
+
+	//save every frame captured, numbered from 0, until stop_sequence():
+	void start_sequence(std::string const &prefix);
+	void stop_sequence();
+	bool sequence_running() const { return sequence; }
+
+	//call after drawing a frame, before swapping buffers:
+	// (reads the back buffer of the default framebuffer, and collects readbacks from earlier frames)
+	void capture(glm::uvec2 const &drawable_size);
+
+	//framebuffer to read frames from (e.g., HeadlessContext::framebuffer); 0 means the window's back buffer:
+	GLuint framebuffer = 0;
+
+	//collect any readbacks still in flight and wait for all PNGs to be written:
+	// (call with the context current, before it is destroyed)
+	void finish();
+
+	//-- internals ---
+
+	//readbacks in flight (a small ring of pixel buffer objects):
+	struct Readback {
+		GLuint buffer = 0; //pixel pack buffer
+		size_t allocated = 0; //bytes allocated for buffer
+		GLsync fence = 0; //(non-zero while in flight)
+		glm::uvec2 size = glm::uvec2(0);
+		std::vector< std::string > filenames; //(a frame can be both a screenshot and part of a sequence)
+	};
+	static constexpr uint32_t RingSize = 3;
+	Readback ring[RingSize];
+	uint32_t next_readback = 0;
+	void collect(Readback &readback); //map, copy out, and queue for encoding (waits for the fence)
+
+	std::string pending_screenshot; //(non-empty => capture next frame)
+	bool sequence = false;
+	std::string sequence_prefix;
+	uint32_t sequence_frame = 0;
+	uint32_t sequence_skipped = 0;
+
+	//pixels waiting to be written (by encode threads):
+	struct Encode {
+		std::vector< std::string > filenames;
+		glm::uvec2 size;
+		std::vector< glm::u8vec4 > data;
+	};
+	std::mutex encode_mutex;
+	std::condition_variable encode_cv; //signalled when work arrives or on quit
+	std::deque< Encode > encode_queue;
+	bool quit = false;
+	std::vector< std::thread > encoders; //(started by the first screenshot or sequence)
+	uint32_t encoder_count = 0; //encoders to start
+	uint32_t max_queued = 0; //sequences skip frames while this many are waiting (set from the number of encoders)
+	void start_encoders();
+	void encode_thread();
+};
@@ -0,0 +1,184 @@
+#include "FrameProfiler.hpp"
+
+#include "DrawLines.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iomanip>
+#include <sstream>
+
+FrameProfiler frame_profiler;
+
+void FrameProfiler::History::push(float value) {
+	if (ms.size() < HistoryLength) {
+		ms.emplace_back(value);
+	} else {
+		ms[next] = value;
+		next = (next + 1) % HistoryLength;
+	}
+}
+
+bool FrameProfiler::History::percentiles(float *p50, float *p95, float *p99) const {
+	if (ms.empty()) return false;
+	std::vector< float > sorted(ms);
+	std::sort(sorted.begin(), sorted.end());
+	auto at = [&sorted](float p) {
+		return sorted[std::min(sorted.size() - 1, size_t(p * float(sorted.size())))];
+	};
+	*p50 = at(0.50f);
+	*p95 = at(0.95f);
+	*p99 = at(0.99f);
+	return true;
+}
+
+void FrameProfiler::begin_frame() {
+	auto now = std::chrono::high_resolution_clock::now();
+	if (frame_started) {
+		frame_history.push(std::chrono::duration< float, std::milli >(now - frame_start).count());
+		for (uint32_t p = 0; p < CpuPhases; ++p) {
+			cpu_history[p].push(cpu_current[p]);
+			cpu_current[p] = 0.0f;
+		}
+	}
+	frame_start = now;
+	frame_started = true;
+
+	read_queries();
+
+	//move on to the next frame's queries:
+	gpu_frame = (gpu_frame + 1) % GpuFrames;
+	gpu_skip = gpu_frames[gpu_frame].pending;
+	if (!gpu_skip) {
+		for (uint32_t p = 0; p < GpuPhases; ++p) {
+			gpu_frames[gpu_frame].used[p] = 0;
+		}
+	}
+}
+
+void FrameProfiler::read_queries() {
+	for (uint32_t i = 1; i < GpuFrames; ++i) {
+		GpuFrame &frame = gpu_frames[(gpu_frame + i) % GpuFrames]; //(oldest first; skips the frame just drawn)
+		if (!frame.pending) continue;
+
+		bool available = true;
+		for (uint32_t p = 0; p < GpuPhases && available; ++p) {
+			for (uint32_t q = 0; q < frame.used[p] && available; ++q) {
+				GLint result_available = GL_FALSE;
+				glGetQueryObjectiv(frame.queries[p][q], GL_QUERY_RESULT_AVAILABLE, &result_available);
+				available = (result_available == GL_TRUE);
+			}
+		}
+		if (!available) break; //(later frames won't be done either)
+
+		for (uint32_t p = 0; p < GpuPhases; ++p) {
+			if (frame.used[p] == 0) continue;
+			GLuint64 total = 0;
+			for (uint32_t q = 0; q < frame.used[p]; ++q) {
+				GLuint64 elapsed = 0;
+				glGetQueryObjectui64v(frame.queries[p][q], GL_QUERY_RESULT, &elapsed);
+				total += elapsed;
+			}
+			gpu_history[p].push(float(total) * 1e-6f);
+			frame.used[p] = 0;
+		}
+		frame.pending = false;
+	}
+}
+
+FrameProfiler::CpuScope::CpuScope(CpuPhase phase_) : phase(phase_), start(std::chrono::high_resolution_clock::now()) {
+	assert(phase < CpuPhases);
+}
+
+FrameProfiler::CpuScope::~CpuScope() {
+	auto end = std::chrono::high_resolution_clock::now();
+	frame_profiler.cpu_current[phase] += std::chrono::duration< float, std::milli >(end - start).count();
+}
+
+FrameProfiler::GpuScope::GpuScope(GpuPhase phase) : measuring(false) {
+	assert(phase < GpuPhases);
+	FrameProfiler &fp = frame_profiler;
+	if (!fp.shown || fp.gpu_skip || fp.gpu_active) return;
+
+	GpuFrame &frame = fp.gpu_frames[fp.gpu_frame];
+	if (frame.used[phase] == frame.queries[phase].size()) {
+		GLuint query = 0;
+		glGenQueries(1, &query);
+		frame.queries[phase].emplace_back(query);
+	}
+	glBeginQuery(GL_TIME_ELAPSED, frame.queries[phase][frame.used[phase]]);
+	frame.used[phase] += 1;
+	frame.pending = true;
+
+	fp.gpu_active = true;
+	measuring = true;
+}
+
+FrameProfiler::GpuScope::~GpuScope() {
+	if (!measuring) return;
+	glEndQuery(GL_TIME_ELAPSED);
+	frame_profiler.gpu_active = false;
+}
+
+void FrameProfiler::draw_overlay(glm::uvec2 const &drawable_size) {
+	if (!shown) return;
+
+	std::vector< std::pair< std::string, History const * > > rows;
+	rows.emplace_back("frame", &frame_history);
+	rows.emplace_back("events", &cpu_history[CpuEvents]);
+	rows.emplace_back("update", &cpu_history[CpuUpdate]);
+	rows.emplace_back("draw", &cpu_history[CpuDraw]);
+	rows.emplace_back("swap", &cpu_history[CpuSwap]);
+	rows.emplace_back("gpu scene", &gpu_history[GpuScene]);
+	rows.emplace_back("gpu lines", &gpu_history[GpuLines]);
+
+	glDisable(GL_DEPTH_TEST);
+	float aspect = float(drawable_size.x) / float(drawable_size.y);
+	DrawLines lines(glm::mat4(
+		1.0f / aspect, 0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f
+	));
+
+	//percentiles table, in the upper right:
+	// (the font isn't monospaced, so each column starts at a fixed offset)
+	constexpr float H = 0.06f;
+	constexpr float Columns[4] = {0.0f, 6.0f * H, 9.0f * H, 12.0f * H};
+	glm::vec3 anchor = glm::vec3(aspect - 15.0f * H, 0.85f, 0.0f);
+	float ofs = 2.0f / drawable_size.y; //(text gets a dark shadow, so it shows up against the snow)
+	auto row = [&](std::string const (&cells)[4], glm::u8vec4 const &color) {
+		for (uint32_t c = 0; c < 4; ++c) {
+			glm::vec3 at = anchor + glm::vec3(Columns[c], 0.0f, 0.0f);
+			lines.draw_text(cells[c], at, glm::vec3(H, 0.0f, 0.0f), glm::vec3(0.0f, H, 0.0f), glm::u8vec4(0x00, 0x00, 0x00, 0xff));
+			lines.draw_text(cells[c], at + glm::vec3(ofs, ofs, 0.0f), glm::vec3(H, 0.0f, 0.0f), glm::vec3(0.0f, H, 0.0f), color);
+		}
+		anchor.y -= 1.3f * H;
+	};
+	row({"ms", "p50", "p95", "p99"}, glm::u8vec4(0xff, 0xff, 0xff, 0xff));
+	for (auto const &name_history : rows) {
+		std::string cells[4] = {name_history.first, "-", "-", "-"};
+		float p[3];
+		if (name_history.second->percentiles(&p[0], &p[1], &p[2])) {
+			for (uint32_t i = 0; i < 3; ++i) {
+				std::ostringstream str;
+				str << std::fixed << std::setprecision(1) << p[i];
+				cells[i + 1] = str.str();
+			}
+		}
+		row(cells, glm::u8vec4(0xff, 0xff, 0x88, 0xff));
+	}
+
+	//graph of recent frame times, along the bottom (with a line at 60 fps):
+	constexpr float GraphHeight = 0.3f; //height of 33.3 ms
+	float x0 = -aspect + 0.05f;
+	float dx = (2.0f * aspect - 0.1f) / float(HistoryLength);
+	float y0 = -0.95f;
+	uint32_t count = uint32_t(frame_history.ms.size());
+	for (uint32_t i = 0; i < count; ++i) {
+		float ms = frame_history.ms[(frame_history.next + i) % count];
+		float height = std::min(1.5f, ms / 33.3f) * GraphHeight;
+		glm::u8vec4 color = (ms > 17.0f ? glm::u8vec4(0xff, 0x44, 0x44, 0xff) : glm::u8vec4(0x44, 0xff, 0x44, 0xff));
+		lines.draw(glm::vec3(x0 + i * dx, y0, 0.0f), glm::vec3(x0 + i * dx, y0 + height, 0.0f), color);
+	}
+	lines.draw(glm::vec3(x0, y0 + 0.5f * GraphHeight, 0.0f), glm::vec3(x0 + HistoryLength * dx, y0 + 0.5f * GraphHeight, 0.0f), glm::u8vec4(0xff, 0xff, 0xff, 0xff));
+}
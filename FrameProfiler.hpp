@@ -0,0 +1,105 @@
+#pragma once
+
+/*
+ * FrameProfiler measures where each frame's time goes, on the CPU and the GPU,
+ *  and draws rolling percentiles (p50/p95/p99 of the last HistoryLength frames)
+ *  as an overlay.
+ *
+ * CPU time is measured with scopes around each phase of the main loop:
+ *
+ * frame_profiler.begin_frame();
+ * { FrameProfiler::CpuScope scope(FrameProfiler::CpuUpdate); Mode::current->update(elapsed); }
+ *
+ * GPU time is measured with GL_TIME_ELAPSED queries around Scene::draw() and
+ *  DrawLines flushes (those call GpuScope themselves):
+ *
+ * { FrameProfiler::GpuScope scope(FrameProfiler::GpuScene); ...draw calls... }
+ *
+ * Query results are read a few frames later, once the GPU has them, so
+ *  measuring never waits for the GPU. (If results are still not in by the
+ *  time their queries are needed again, that frame just isn't measured.)
+ *  GPU scopes don't nest -- an inner scope is not measured -- and only run
+ *  while the overlay is shown.
+ *
+ */
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct FrameProfiler {
+	enum CpuPhase : uint32_t {
+		CpuEvents,
+		CpuUpdate,
+		CpuDraw,
+		CpuSwap,
+		CpuPhases //<-- just used to track # of phases
+	};
+	enum GpuPhase : uint32_t {
+		GpuScene,
+		GpuLines,
+		GpuPhases //<-- just used to track # of phases
+	};
+
+	//call at the start of every frame (finishes recording the previous one):
+	void begin_frame();
+
+	//add the time until the scope ends to the current frame's phase:
+	struct CpuScope {
+		CpuScope(CpuPhase phase);
+		~CpuScope();
+		CpuPhase phase;
+		std::chrono::high_resolution_clock::time_point start;
+	};
+
+	//measure the GPU time of OpenGL commands issued until the scope ends:
+	struct GpuScope {
+		GpuScope(GpuPhase phase);
+		~GpuScope();
+		bool measuring; //(false if not shown, nested, or out of queries)
+	};
+
+	//draw the percentiles (and a graph of recent frame times) over the top of whatever is in the framebuffer:
+	void draw_overlay(glm::uvec2 const &drawable_size);
+
+	bool shown = false; //draw_overlay() does nothing (and GPU time isn't measured) unless this is set
+
+	//-- internals ---
+
+	//a rolling window of times (in milliseconds):
+	static constexpr uint32_t HistoryLength = 300;
+	struct History {
+		std::vector< float > ms; //(up to HistoryLength, oldest at 'next' once full)
+		uint32_t next = 0;
+		void push(float value);
+		//percentiles of the window; returns false if there are no samples:
+		bool percentiles(float *p50, float *p95, float *p99) const;
+	};
+	History frame_history; //start of frame to start of next frame
+	History cpu_history[CpuPhases];
+	History gpu_history[GpuPhases];
+
+	std::chrono::high_resolution_clock::time_point frame_start;
+	bool frame_started = false;
+	float cpu_current[CpuPhases] = { }; //milliseconds so far this frame
+
+	//queries for each of the last few frames (reused round-robin):
+	static constexpr uint32_t GpuFrames = 4;
+	struct GpuFrame {
+		std::vector< GLuint > queries[GpuPhases]; //(generated as needed)
+		uint32_t used[GpuPhases] = { }; //queries used this frame
+		bool pending = false; //true if any queries are waiting for results
+	};
+	GpuFrame gpu_frames[GpuFrames];
+	uint32_t gpu_frame = 0;
+	bool gpu_skip = false; //this frame's queries are still waiting from GpuFrames frames ago
+	bool gpu_active = false; //a GpuScope is measuring
+	void read_queries(); //read results of earlier frames, if they are in
+};
+
+extern FrameProfiler frame_profiler;
@@ -0,0 +1,162 @@
+#include "Frustum.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <cassert>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define FRUSTUM_X86
+#include <emmintrin.h>
+#endif
+
+Frustum::Frustum(glm::mat4 const &world_to_clip) {
+	//Gribb & Hartmann: clip-space -w <= x,y,z <= w become (row3 +/- row_i) . (p,1) >= 0:
+	auto row = [&world_to_clip](uint32_t i) {
+		return glm::vec4(world_to_clip[0][i], world_to_clip[1][i], world_to_clip[2][i], world_to_clip[3][i]);
+	};
+	planes[0] = row(3) + row(0); //left
+	planes[1] = row(3) - row(0); //right
+	planes[2] = row(3) + row(1); //bottom
+	planes[3] = row(3) - row(1); //top
+	planes[4] = row(3) + row(2); //near
+	planes[5] = row(3) - row(2); //far
+
+	for (glm::vec4 &plane : planes) {
+		float len = glm::length(glm::vec3(plane));
+		if (len > 1e-6f * std::abs(plane.w) && len > 0.0f) {
+			plane /= len;
+		} else {
+			plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		}
+	}
+}
+
+glm::vec4 Frustum::bounding_sphere(glm::mat4x3 const &object_to_world, glm::vec3 const &min, glm::vec3 const &max) {
+	glm::vec3 center = object_to_world * glm::vec4(0.5f * (min + max), 1.0f);
+	float scale = std::max(glm::length(object_to_world[0]), std::max(glm::length(object_to_world[1]), glm::length(object_to_world[2])));
+	return glm::vec4(center, 0.5f * glm::length(max - min) * scale);
+}
+
+namespace {
+
+//number of set bits in a visibility byte:
+uint32_t bit_count(uint32_t v) {
+	uint32_t count = 0;
+	for (; v; v &= v - 1) ++count;
+	return count;
+}
+
+//reference implementation; also handles the partial block at the end of the arrays:
+size_t frustum_cull_scalar(Frustum const &frustum, size_t begin, size_t end,
+	float const *x, float const *y, float const *z, float const *r,
+	uint8_t *visible) {
+
+	assert(begin % 8 == 0);
+	size_t total = 0;
+	for (size_t block = begin; block < end; block += 8) {
+		uint8_t v = 0;
+		for (size_t i = block; i < block + 8 && i < end; ++i) {
+			bool inside = true;
+			for (glm::vec4 const &p : frustum.planes) {
+				//n.b. same operation order as the SIMD path, so results match exactly:
+				float dist = ((p.x * x[i] + p.y * y[i]) + p.z * z[i]) + p.w;
+				inside = inside && !(dist < -r[i]);
+			}
+			if (inside) {
+				v |= uint8_t(1 << (i - block));
+				total += 1;
+			}
+		}
+		visible[block / 8] = v;
+	}
+	return total;
+}
+
+#ifdef FRUSTUM_X86
+
+//eight spheres per iteration as two four-wide halves:
+size_t frustum_cull_sse2(Frustum const &frustum, size_t count,
+	float const *x, float const *y, float const *z, float const *r,
+	uint8_t *visible, size_t *total) {
+
+	__m128 pa[6], pb[6], pc[6], pd[6];
+	for (uint32_t p = 0; p < 6; ++p) {
+		pa[p] = _mm_set1_ps(frustum.planes[p].x);
+		pb[p] = _mm_set1_ps(frustum.planes[p].y);
+		pc[p] = _mm_set1_ps(frustum.planes[p].z);
+		pd[p] = _mm_set1_ps(frustum.planes[p].w);
+	}
+	__m128 const zero = _mm_setzero_ps();
+
+	size_t const blocks = count / 8;
+	for (size_t b = 0; b < blocks; ++b) {
+		int v = 0;
+		for (size_t h = 0; h < 2; ++h) {
+			size_t i = b * 8 + h * 4;
+			__m128 px = _mm_loadu_ps(x + i);
+			__m128 py = _mm_loadu_ps(y + i);
+			__m128 pz = _mm_loadu_ps(z + i);
+			__m128 neg_r = _mm_sub_ps(zero, _mm_loadu_ps(r + i));
+
+			__m128 outside = zero;
+			for (uint32_t p = 0; p < 6; ++p) {
+				__m128 dist = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(pa[p], px), _mm_mul_ps(pb[p], py)), _mm_mul_ps(pc[p], pz)), pd[p]);
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, neg_r));
+			}
+			v |= (~_mm_movemask_ps(outside) & 0xf) << (h * 4);
+		}
+		visible[b] = uint8_t(v);
+		*total += bit_count(uint32_t(v));
+	}
+	return blocks * 8;
+}
+
+#endif //FRUSTUM_X86
+
+} //namespace
+
+char const *frustum_kernel_name(FrustumKernel kernel) {
+	if (kernel == FrustumScalar) return "scalar";
+	else if (kernel == FrustumSSE2) return "sse2";
+	else return "unknown";
+}
+
+bool frustum_kernel_supported(FrustumKernel kernel) {
+	if (kernel == FrustumScalar) return true;
+	#ifdef FRUSTUM_X86
+	if (kernel == FrustumSSE2) return true; //SSE2 is baseline on x86-64 (and assumed on x86)
+	#endif
+	return false;
+}
+
+FrustumKernel frustum_best_kernel() {
+	if (frustum_kernel_supported(FrustumSSE2)) return FrustumSSE2;
+	return FrustumScalar;
+}
+
+size_t frustum_cull(
+	Frustum const &frustum,
+	size_t count,
+	float const *x, float const *y, float const *z, float const *r,
+	uint8_t *visible,
+	FrustumKernel kernel) {
+
+	if (!frustum_kernel_supported(kernel)) {
+		throw std::runtime_error("Frustum kernel '" + std::string(frustum_kernel_name(kernel)) + "' is not supported on this machine.");
+	}
+
+	//full blocks of eight go through the SIMD path (if any):
+	size_t done = 0;
+	size_t total = 0;
+	#ifdef FRUSTUM_X86
+	if (kernel == FrustumSSE2) {
+		done = frustum_cull_sse2(frustum, count, x, y, z, r, visible, &total);
+	}
+	#endif
+
+	//whatever is left goes through the scalar path:
+	total += frustum_cull_scalar(frustum, done, count, x, y, z, r, visible);
+	return total;
+}
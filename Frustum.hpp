@@ -0,0 +1,96 @@
+#pragma once
+
+/*
+ * View-frustum culling of bounding spheres.
+ *
+ * A "Frustum" holds the six planes of a world_to_clip matrix's view volume;
+ *  frustum_cull() tests many spheres (stored as a structure of arrays)
+ *  against them at once and writes a visibility bitmask.
+ *
+ * Spheres are processed four at a time using SSE2 when available, with a
+ *  plain scalar implementation as a fallback (and for reference).
+ *
+ */
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Frustum {
+	//planes (a,b,c,d) with unit-length normals pointing into the view volume:
+	// point p is inside plane i if dot(planes[i], vec4(p, 1)) >= 0
+	// (degenerate planes -- e.g., the far plane of an infinite projection -- are stored as (0,0,0,1), which everything is inside)
+	glm::vec4 planes[6];
+
+	//extract planes from a (column-major, OpenGL clip space) world_to_clip matrix:
+	explicit Frustum(glm::mat4 const &world_to_clip);
+
+	//world-space bounding sphere of an object-space box [min,max] under object_to_world:
+	// (conservative: box's half-diagonal times object_to_world's largest axis scale)
+	static glm::vec4 bounding_sphere(glm::mat4x3 const &object_to_world, glm::vec3 const &min, glm::vec3 const &max);
+};
+
+//Culling counts, for instrumentation:
+struct CullStats {
+	uint32_t tested = 0; //objects with bounds that were tested against the frustum
+	uint32_t culled = 0; //...of which this many were outside
+	uint32_t visible() const { return tested - culled; }
+};
+
+enum FrustumKernel : uint32_t {
+	FrustumScalar,
+	FrustumSSE2,
+	FrustumKernelCount //<-- just used to track # of kernels
+};
+
+//human-readable kernel name (for benchmarks / logging):
+char const *frustum_kernel_name(FrustumKernel kernel);
+
+//is this kernel compiled in and supported by the current CPU?
+bool frustum_kernel_supported(FrustumKernel kernel);
+
+//fastest supported kernel:
+FrustumKernel frustum_best_kernel();
+
+//test 'count' spheres (x,y,z)[i] with radius r[i] against 'frustum':
+//   bit (i % 8) of byte (i / 8) of 'visible' is set if sphere i is not entirely outside any plane.
+// 'visible' must have room for (count + 7) / 8 bytes.
+// Bits past 'count' in the last byte are set to zero.
+// (returns the number of visible spheres)
+size_t frustum_cull(
+	Frustum const &frustum,
+	size_t count,
+	float const *x, float const *y, float const *z, float const *r,
+	uint8_t *visible,
+	FrustumKernel kernel = frustum_best_kernel()
+);
+
+//bounding spheres gathered for one frustum_cull() call (keep one around to re-use its allocations):
+struct CullBatch {
+	std::vector< float > x, y, z, r;
+	std::vector< uint8_t > visible;
+
+	void clear() {
+		x.clear(); y.clear(); z.clear(); r.clear();
+	}
+	//returns index of the sphere in the batch:
+	uint32_t add(glm::vec4 const &sphere) {
+		x.emplace_back(sphere.x);
+		y.emplace_back(sphere.y);
+		z.emplace_back(sphere.z);
+		r.emplace_back(sphere.w);
+		return uint32_t(x.size() - 1);
+	}
+	//test every sphere added since clear(); afterwards, is_visible(i) gives the result for sphere i:
+	void cull(Frustum const &frustum, CullStats &stats) {
+		visible.resize((x.size() + 7) / 8);
+		size_t count = frustum_cull(frustum, x.size(), x.data(), y.data(), z.data(), r.data(), visible.data());
+		stats.tested += uint32_t(x.size());
+		stats.culled += uint32_t(x.size() - count);
+	}
+	bool is_visible(uint32_t i) const {
+		return (visible[i / 8] & (1 << (i % 8))) != 0;
+	}
+};
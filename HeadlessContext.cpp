@@ -0,0 +1,139 @@
+#include "HeadlessContext.hpp"
+
+#include "gl_errors.hpp"
+
+#include <stdexcept>
+
+#if defined(__linux__)
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstring>
+
+//EGL error code as text, for error messages:
+static std::string egl_error() {
+	EGLint error = eglGetError();
+	char const *name = "unknown error";
+	switch (error) {
+		case EGL_NOT_INITIALIZED: name = "EGL_NOT_INITIALIZED"; break;
+		case EGL_BAD_ACCESS: name = "EGL_BAD_ACCESS"; break;
+		case EGL_BAD_ALLOC: name = "EGL_BAD_ALLOC"; break;
+		case EGL_BAD_ATTRIBUTE: name = "EGL_BAD_ATTRIBUTE"; break;
+		case EGL_BAD_CONFIG: name = "EGL_BAD_CONFIG"; break;
+		case EGL_BAD_CONTEXT: name = "EGL_BAD_CONTEXT"; break;
+		case EGL_BAD_DISPLAY: name = "EGL_BAD_DISPLAY"; break;
+		case EGL_BAD_MATCH: name = "EGL_BAD_MATCH"; break;
+		case EGL_BAD_PARAMETER: name = "EGL_BAD_PARAMETER"; break;
+	}
+	return std::string(name) + " (" + std::to_string(error) + ")";
+}
+
+HeadlessContext::HeadlessContext(glm::uvec2 const &size_) : size(size_) {
+	if (size.x == 0 || size.y == 0) throw std::runtime_error("Headless framebuffer must not be empty.");
+
+	//surfaceless display (no X11/Wayland connection needed):
+	EGLDisplay egl_display = EGL_NO_DISPLAY;
+	char const *client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	if (client_extensions && std::strstr(client_extensions, "EGL_MESA_platform_surfaceless")) {
+		auto get_platform_display = reinterpret_cast< PFNEGLGETPLATFORMDISPLAYEXTPROC >(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+		if (get_platform_display) egl_display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+	if (egl_display == EGL_NO_DISPLAY) {
+		egl_display = eglGetDisplay(EGL_DEFAULT_DISPLAY); //(may still work, e.g. with a vendor driver's device platform)
+	}
+	if (egl_display == EGL_NO_DISPLAY) throw std::runtime_error("Failed to get an EGL display: " + egl_error());
+
+	EGLint major = 0, minor = 0;
+	if (!eglInitialize(egl_display, &major, &minor)) throw std::runtime_error("Failed to initialize EGL: " + egl_error());
+	display = egl_display;
+
+	//from here on, clean up on failure:
+	auto fail = [&](std::string const &what) {
+		eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (context) eglDestroyContext(egl_display, context);
+		eglTerminate(egl_display);
+		return std::runtime_error(what);
+	};
+
+	char const *display_extensions = eglQueryString(egl_display, EGL_EXTENSIONS);
+	if (!display_extensions || !std::strstr(display_extensions, "EGL_KHR_surfaceless_context")) {
+		throw fail("EGL " + std::to_string(major) + "." + std::to_string(minor) + " display doesn't support EGL_KHR_surfaceless_context.");
+	}
+
+	if (!eglBindAPI(EGL_OPENGL_API)) throw fail("EGL can't create desktop OpenGL contexts: " + egl_error());
+
+	EGLint const config_attribs[] = {
+		EGL_SURFACE_TYPE, 0, //(no surfaces)
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config = nullptr;
+	EGLint configs = 0;
+	if (!eglChooseConfig(egl_display, config_attribs, &config, 1, &configs) || configs == 0) {
+		throw fail("No EGL config for a surfaceless OpenGL context: " + egl_error());
+	}
+
+	//same version and profile as the windowed context (see main.cpp):
+	EGLint const context_attribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	context = eglCreateContext(egl_display, config, EGL_NO_CONTEXT, context_attribs);
+	if (context == EGL_NO_CONTEXT) {
+		context = nullptr;
+		throw fail("Failed to create an OpenGL 3.3 core context: " + egl_error());
+	}
+	if (!eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+		throw fail("Failed to make the headless context current: " + egl_error());
+	}
+
+	init_GL();
+
+	renderer = reinterpret_cast< char const * >(glGetString(GL_RENDERER));
+
+	//framebuffer to draw into (same formats as the window asks for):
+	glGenRenderbuffers(1, &color_renderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, color_renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size.x, size.y);
+
+	glGenRenderbuffers(1, &depth_stencil_renderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth_stencil_renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, size.x, size.y);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_renderbuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth_stencil_renderbuffer);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		throw fail("Headless framebuffer is incomplete (status " + std::to_string(status) + ").");
+	}
+	glViewport(0, 0, size.x, size.y);
+
+	GL_ERRORS();
+}
+
+HeadlessContext::~HeadlessContext() {
+	if (framebuffer) glDeleteFramebuffers(1, &framebuffer);
+	if (color_renderbuffer) glDeleteRenderbuffers(1, &color_renderbuffer);
+	if (depth_stencil_renderbuffer) glDeleteRenderbuffers(1, &depth_stencil_renderbuffer);
+
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglDestroyContext(display, context);
+	eglTerminate(display);
+}
+
+#else //not linux
+
+HeadlessContext::HeadlessContext(glm::uvec2 const &size_) : size(size_) {
+	throw std::runtime_error("Headless rendering is only supported on Linux.");
+}
+
+HeadlessContext::~HeadlessContext() {
+}
+
+#endif
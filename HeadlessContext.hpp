@@ -0,0 +1,44 @@
+#pragma once
+
+/*
+ * A HeadlessContext is an OpenGL 3.3 core context with no window (and no
+ *  display server), for running the game where there is no screen -- e.g.,
+ *  benchmarking on a build machine (see '--headless' in main.cpp).
+ *
+ * It uses EGL's surfaceless platform (EGL_MESA_platform_surfaceless). With
+ *  Mesa on a machine without a GPU this is the llvmpipe software rasterizer;
+ *  LIBGL_ALWAYS_SOFTWARE=1 picks llvmpipe even if there is a GPU.
+ *
+ * A surfaceless context has no default framebuffer, so the context renders
+ *  into 'framebuffer' (color + depth/stencil renderbuffers of the given size),
+ *  which the constructor leaves bound; code that binds framebuffer 0 to draw
+ *  should bind this one instead.
+ *
+ * (Linux only; elsewhere, the constructor throws.)
+ *
+ */
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <string>
+
+struct HeadlessContext {
+	HeadlessContext(glm::uvec2 const &size); //creates and makes current; throws on failure
+	~HeadlessContext();
+
+	HeadlessContext(HeadlessContext const &) = delete;
+	HeadlessContext &operator=(HeadlessContext const &) = delete;
+
+	glm::uvec2 size;
+	GLuint framebuffer = 0;
+	GLuint color_renderbuffer = 0;
+	GLuint depth_stencil_renderbuffer = 0;
+
+	std::string renderer; //GL_RENDERER, e.g. "llvmpipe (LLVM 15.0.6, 256 bits)"
+
+	//-- internals ---
+	void *display = nullptr; //EGLDisplay
+	void *context = nullptr; //EGLContext
+};
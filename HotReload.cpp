@@ -0,0 +1,131 @@
+#include "HotReload.hpp"
+
+#include "AssetPack.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <tuple>
+
+HotReload::~HotReload() {
+	for (auto &mesh : meshes) {
+		if (mesh->reading.valid()) mesh->reading.wait();
+	}
+}
+
+//start reading a changed mesh file in the background:
+static void start_reading(HotReload::MeshWatch &mesh) {
+	std::cout << "Reloading '" << mesh.filename << "'..." << std::endl;
+	std::string filename = mesh.filename;
+	mesh.reading = std::async(std::launch::async, [filename]() {
+		//(copied out of the file, since the exporter may rewrite it again before the upload)
+		return MeshBuffer::prepare(filename, true);
+	});
+}
+
+void HotReload::watch_meshes(std::string const &filename, MeshBuffer const **buffer,
+	std::function< void(MeshBuffer const &, MeshBuffer const &) > const &on_reload) {
+	assert(buffer);
+	if (AssetPack::find_data_path(filename)) {
+		std::cout << "NOTE: '" << filename << "' is read from the asset pack, so it won't be reloaded if it changes." << std::endl;
+		return;
+	}
+	meshes.emplace_back(std::make_unique< MeshWatch >());
+	MeshWatch &mesh = *meshes.back();
+	mesh.filename = filename;
+	mesh.buffer = buffer;
+	mesh.on_reload = on_reload;
+	watcher.add(filename);
+}
+
+void HotReload::watch(std::string const &filename, std::function< void() > const &on_change) {
+	if (AssetPack::find_data_path(filename)) {
+		std::cout << "NOTE: '" << filename << "' is read from the asset pack, so it won't be reloaded if it changes." << std::endl;
+		return;
+	}
+	files.emplace_back(FileWatch{filename, on_change});
+	watcher.add(filename);
+}
+
+void HotReload::update() {
+	for (std::string const &filename : watcher.changed()) {
+		for (auto &mesh : meshes) {
+			if (mesh->filename != filename) continue;
+			if (mesh->reading.valid()) mesh->changed_again = true;
+			else start_reading(*mesh);
+		}
+		for (auto &file : files) {
+			if (file.filename != filename) continue;
+			std::cout << "Reloading '" << filename << "'..." << std::endl;
+			try {
+				file.on_change();
+			} catch (std::exception &e) {
+				std::cerr << "Failed to reload '" << filename << "': " << e.what() << std::endl;
+			}
+		}
+	}
+
+	//swap in meshes that are done being read:
+	for (auto &mesh_ptr : meshes) {
+		MeshWatch &mesh = *mesh_ptr;
+		if (!mesh.reading.valid()) continue;
+		if (mesh.reading.wait_for(std::chrono::seconds(0)) != std::future_status::ready) continue;
+
+		try {
+			std::shared_ptr< MeshBuffer::Prepared const > prepared = mesh.reading.get();
+			MeshBuffer const *old_buffer = *mesh.buffer;
+			MeshBuffer const *new_buffer = new MeshBuffer(*prepared);
+			*mesh.buffer = new_buffer;
+			mesh.on_reload(*old_buffer, *new_buffer);
+
+			//(nothing refers to the old buffer any more)
+			glDeleteBuffers(1, &old_buffer->buffer);
+			if (old_buffer->index_buffer) glDeleteBuffers(1, &old_buffer->index_buffer);
+			delete old_buffer;
+			std::cout << "Reloaded '" << mesh.filename << "' (" << new_buffer->meshes.size() << " meshes)." << std::endl;
+		} catch (std::exception &e) {
+			std::cerr << "Failed to reload '" << mesh.filename << "': " << e.what() << std::endl;
+		}
+
+		if (mesh.changed_again) {
+			mesh.changed_again = false;
+			start_reading(mesh);
+		}
+	}
+}
+
+void retarget_drawables(Scene &scene, MeshBuffer const &old_buffer, GLuint old_vao, MeshBuffer const &new_buffer, GLuint new_vao) {
+	//drawables only know the range they draw, so find mesh names by range:
+	std::map< std::tuple< GLuint, GLuint, GLenum >, std::string > range_to_name;
+	for (auto const &name_mesh : old_buffer.meshes) {
+		Mesh const &mesh = name_mesh.second;
+		range_to_name.emplace(std::make_tuple(mesh.start, mesh.count, mesh.index_type), name_mesh.first);
+	}
+
+	auto retarget = [&](auto &pipeline) {
+		if (pipeline.vao != old_vao) return;
+		pipeline.vao = new_vao;
+
+		Mesh const *mesh = nullptr;
+		auto f = range_to_name.find(std::make_tuple(pipeline.start, pipeline.count, pipeline.index_type));
+		if (f != range_to_name.end()) {
+			auto g = new_buffer.meshes.find(f->second);
+			if (g != new_buffer.meshes.end()) mesh = &g->second;
+		}
+		if (!mesh) {
+			pipeline.count = 0; //(mesh no longer exists; draw nothing)
+			return;
+		}
+		pipeline.type = mesh->type;
+		pipeline.start = mesh->start;
+		pipeline.count = mesh->count;
+		pipeline.index_type = mesh->index_type;
+		pipeline.min = mesh->min;
+		pipeline.max = mesh->max;
+		pipeline.position_scale = mesh->position_scale;
+		pipeline.position_offset = mesh->position_offset;
+		pipeline.octahedral_normals = mesh->octahedral_normals;
+	};
+	for (auto &drawable : scene.drawables) retarget(drawable.pipeline);
+	for (auto &drawable : scene.instanced_drawables) retarget(drawable.pipeline);
+}
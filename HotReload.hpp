@@ -0,0 +1,78 @@
+#pragma once
+
+/*
+ * HotReload reloads meshes and scenes while the game runs, when their files
+ *  change on disk (see AssetWatch.hpp) -- so re-exporting from Blender
+ *  doesn't mean restarting the game.
+ *
+ * Mesh files are re-read (MeshBuffer::prepare) on a background thread; the
+ *  upload and the swap to the new MeshBuffer happen in update(), between
+ *  frames. Each swap calls back to the owner of the buffer, which should make
+ *  new vertex array objects and point its drawables at them (retarget_drawables).
+ *
+ * Other files (e.g., scenes) just get a callback from update(); to keep the
+ *  state of a live scene, rebuild the scene and use Scene::reload().
+ *
+ * //in a mode's constructor:
+ * hot_reload.watch_meshes(data_path("level.pnct"), &level_meshes.value, [this](MeshBuffer const &old_buffer, MeshBuffer const &new_buffer) {
+ *     GLuint vao = new_buffer.make_vao_for_program(program);
+ *     retarget_drawables(scene, old_buffer, level_vao, new_buffer, vao);
+ *     glDeleteVertexArrays(1, &level_vao);
+ *     level_vao = vao;
+ * });
+ * //...at the start of update():
+ * hot_reload.update();
+ *
+ * Files served from the game's asset pack (see AssetPack.hpp) can't change, so they aren't watched.
+ *
+ */
+
+#include "AssetWatch.hpp"
+#include "Mesh.hpp"
+#include "Scene.hpp"
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct HotReload {
+	HotReload() = default;
+	~HotReload(); //(waits for any mesh files still being read)
+
+	//watch a mesh file, whose MeshBuffer is *buffer (e.g., &some_load.value):
+	// when the file changes, update() replaces *buffer with a new MeshBuffer, calls on_reload(old, new), and then deletes the old one.
+	void watch_meshes(std::string const &filename, MeshBuffer const **buffer,
+		std::function< void(MeshBuffer const &old_buffer, MeshBuffer const &new_buffer) > const &on_reload);
+
+	//watch any file; on_change() is called from update() after it changes:
+	void watch(std::string const &filename, std::function< void() > const &on_change);
+
+	//call between frames, on the OpenGL thread: starts reading changed mesh files and swaps in any that are ready.
+	// (if a file fails to load -- e.g., it was only partly written -- the error is printed and the old data kept)
+	void update();
+
+	//-- internals ---
+	AssetWatch watcher;
+
+	struct MeshWatch {
+		std::string filename;
+		MeshBuffer const **buffer;
+		std::function< void(MeshBuffer const &, MeshBuffer const &) > on_reload;
+		std::future< std::shared_ptr< MeshBuffer::Prepared const > > reading; //(valid while being read)
+		bool changed_again = false; //file changed while it was being read, so read it again after
+	};
+	std::vector< std::unique_ptr< MeshWatch > > meshes;
+
+	struct FileWatch {
+		std::string filename;
+		std::function< void() > on_change;
+	};
+	std::vector< FileWatch > files;
+};
+
+//point drawables (and instanced drawables) in 'scene' that draw meshes of 'old_buffer' through 'old_vao' at the
+// same-named meshes of 'new_buffer', drawn through 'new_vao':
+// (drawables are matched to meshes by their range of vertices or elements; if a mesh is gone, its drawables get an empty range)
+void retarget_drawables(Scene &scene, MeshBuffer const &old_buffer, GLuint old_vao, MeshBuffer const &new_buffer, GLuint new_vao);
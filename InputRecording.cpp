@@ -0,0 +1,25 @@
+#include "InputRecording.hpp"
+
+#include "ChunkFile.hpp"
+#include "read_write_chunk.hpp"
+
+#include <fstream>
+
+void InputRecording::save(std::string const &filename) const {
+	std::ofstream file(filename, std::ios::binary);
+	write_chunk("inp0", std::vector< Header >{ header }, &file);
+	write_chunk("tick", ticks, &file);
+	if (!file) throw std::runtime_error("Failed to write input recording to '" + filename + "'.");
+}
+
+InputRecording InputRecording::load(std::string const &filename) {
+	ChunkFile file(filename);
+	auto header = file.find< Header >("inp0");
+	if (header.size() != 1) throw std::runtime_error("Input recording '" + filename + "' should have exactly one header.");
+	auto ticks = file.find< uint8_t >("tick");
+
+	InputRecording ret;
+	ret.header = header[0];
+	ret.ticks.assign(ticks.begin(), ticks.end());
+	return ret;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+/*
+ * An InputRecording is the input to every tick of a game session, so the
+ *  session can be replayed exactly (e.g., to compare frame times of builds on
+ *  the same canonical run). PlayMode records and replays them; see '--record'
+ *  and '--replay' in main.cpp.
+ *
+ * Since the game advances in fixed ticks (see PlayMode::Tick) and all of its
+ *  randomness comes from the process-wide seed (see Random.hpp), the seed plus
+ *  the buttons held during each tick determine the whole session. The state
+ *  hash at the end of the recording lets a replay check that it matched.
+ *
+ * File format (chunks, as written by write_chunk in read_write_chunk.hpp):
+ *  'inp0': one Header
+ *  'tick': one byte per tick -- bits 0-3: buttons held (left, right, down, up);
+ *          bits 4-7: buttons pressed during the tick (same order)
+ *
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct InputRecording {
+	struct Header {
+		uint64_t seed = 0; //random_seed() of the recorded session
+		float tick = 0.0f; //seconds per tick
+		uint32_t final_hash = 0; //SnowWorld::state_hash() after the last tick
+	};
+	static_assert(sizeof(Header) == 16, "Header is packed.");
+	Header header;
+
+	std::vector< uint8_t > ticks;
+
+	//throw on failure:
+	void save(std::string const &filename) const;
+	static InputRecording load(std::string const &filename);
+};
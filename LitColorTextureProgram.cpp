@@ -1,9 +1,11 @@
 #include "LitColorTextureProgram.hpp"
 
+#include "Mesh.hpp"
 #include "gl_compile_program.hpp"
 #include "gl_errors.hpp"
 
 Scene::Drawable::Pipeline lit_color_texture_program_pipeline;
+Scene::InstancedDrawable::Pipeline lit_color_texture_instanced_program_pipeline;
 
 Load< LitColorTextureProgram > lit_color_texture_program(LoadTagEarly, []() -> LitColorTextureProgram const * {
 	LitColorTextureProgram *ret = new LitColorTextureProgram();
@@ -15,6 +17,10 @@ Load< LitColorTextureProgram > lit_color_texture_program(LoadTagEarly, []() -> L
 	lit_color_texture_program_pipeline.OBJECT_TO_LIGHT_mat4x3 = ret->OBJECT_TO_LIGHT_mat4x3;
 	lit_color_texture_program_pipeline.NORMAL_TO_LIGHT_mat3 = ret->NORMAL_TO_LIGHT_mat3;
 
+	lit_color_texture_program_pipeline.POSITION_SCALE_vec3 = ret->POSITION_SCALE_vec3;
+	lit_color_texture_program_pipeline.POSITION_OFFSET_vec3 = ret->POSITION_OFFSET_vec3;
+	lit_color_texture_program_pipeline.OCTAHEDRAL_NORMALS_bool = ret->OCTAHEDRAL_NORMALS_bool;
+
 	/* This will be used later if/when we build a light loop into the Scene:
 	lit_color_texture_program_pipeline.LIGHT_TYPE_int = ret->LIGHT_TYPE_int;
 	lit_color_texture_program_pipeline.LIGHT_LOCATION_vec3 = ret->LIGHT_LOCATION_vec3;
@@ -43,11 +49,55 @@ Load< LitColorTextureProgram > lit_color_texture_program(LoadTagEarly, []() -> L
 	return ret;
 });
 
-LitColorTextureProgram::LitColorTextureProgram() {
+Load< LitColorTextureProgram > lit_color_texture_instanced_program(LoadTagEarly, []() -> LitColorTextureProgram const * {
+	LitColorTextureProgram *ret = new LitColorTextureProgram(LitColorTextureProgram::Instanced);
+
+	//----- build the pipeline template -----
+	lit_color_texture_instanced_program_pipeline.program = ret->program;
+
+	lit_color_texture_instanced_program_pipeline.WORLD_TO_CLIP_mat4 = ret->WORLD_TO_CLIP_mat4;
+	lit_color_texture_instanced_program_pipeline.WORLD_TO_LIGHT_mat4x3 = ret->WORLD_TO_LIGHT_mat4x3;
+
+	lit_color_texture_instanced_program_pipeline.POSITION_SCALE_vec3 = ret->POSITION_SCALE_vec3;
+	lit_color_texture_instanced_program_pipeline.POSITION_OFFSET_vec3 = ret->POSITION_OFFSET_vec3;
+	lit_color_texture_instanced_program_pipeline.OCTAHEDRAL_NORMALS_bool = ret->OCTAHEDRAL_NORMALS_bool;
+
+	//share the 1-pixel white texture made for the non-instanced pipeline:
+	// (this relies on lit_color_texture_program being loaded first, which it is, since it is defined above)
+	lit_color_texture_instanced_program_pipeline.textures[0] = lit_color_texture_program_pipeline.textures[0];
+
+	return ret;
+});
+
+LitColorTextureProgram::LitColorTextureProgram(Variant variant) {
 	//Compile vertex and fragment shaders using the convenient 'gl_compile_program' helper function:
 	program = gl_compile_program(
 		//vertex shader:
-		"#version 330\n"
+		//(mesh_decode_glsl provides decode_position and decode_normal; see Mesh.hpp)
+		(variant == Instanced ?
+		std::string("#version 330\n") + mesh_decode_glsl +
+		"uniform mat4 WORLD_TO_CLIP;\n"
+		"uniform mat4x3 WORLD_TO_LIGHT;\n"
+		"in mat4x3 OBJECT_TO_WORLD;\n" //per-instance
+		"in vec4 Position;\n"
+		"in vec3 Normal;\n"
+		"in vec4 Color;\n"
+		"in vec2 TexCoord;\n"
+		"out vec3 position;\n"
+		"out vec3 normal;\n"
+		"out vec4 color;\n"
+		"out vec2 texCoord;\n"
+		"void main() {\n"
+		"	vec4 p = decode_position(Position);\n"
+		"	gl_Position = WORLD_TO_CLIP * vec4(OBJECT_TO_WORLD * p, 1.0);\n"
+		"	mat4x3 object_to_light = WORLD_TO_LIGHT * mat4(OBJECT_TO_WORLD);\n" //n.b. mat4(mat4x3) pads with a (0,0,0,1) row
+		"	position = object_to_light * p;\n"
+		"	normal = inverse(transpose(mat3(object_to_light))) * decode_normal(Normal);\n"
+		"	color = Color;\n"
+		"	texCoord = TexCoord;\n"
+		"}\n"
+		:
+		std::string("#version 330\n") + mesh_decode_glsl +
 		"uniform mat4 OBJECT_TO_CLIP;\n"
 		"uniform mat4x3 OBJECT_TO_LIGHT;\n"
 		"uniform mat3 NORMAL_TO_LIGHT;\n"
@@ -60,12 +110,14 @@ LitColorTextureProgram::LitColorTextureProgram() {
 		"out vec4 color;\n"
 		"out vec2 texCoord;\n"
 		"void main() {\n"
-		"	gl_Position = OBJECT_TO_CLIP * Position;\n"
-		"	position = OBJECT_TO_LIGHT * Position;\n"
-		"	normal = NORMAL_TO_LIGHT * Normal;\n"
+		"	vec4 p = decode_position(Position);\n"
+		"	gl_Position = OBJECT_TO_CLIP * p;\n"
+		"	position = OBJECT_TO_LIGHT * p;\n"
+		"	normal = NORMAL_TO_LIGHT * decode_normal(Normal);\n"
 		"	color = Color;\n"
 		"	texCoord = TexCoord;\n"
 		"}\n"
+		)
 	,
 		//fragment shader:
 		"#version 330\n"
@@ -114,11 +166,18 @@ LitColorTextureProgram::LitColorTextureProgram() {
 	Normal_vec3 = glGetAttribLocation(program, "Normal");
 	Color_vec4 = glGetAttribLocation(program, "Color");
 	TexCoord_vec2 = glGetAttribLocation(program, "TexCoord");
+	OBJECT_TO_WORLD_mat4x3 = glGetAttribLocation(program, "OBJECT_TO_WORLD");
 
 	//look up the locations of uniforms:
 	OBJECT_TO_CLIP_mat4 = glGetUniformLocation(program, "OBJECT_TO_CLIP");
 	OBJECT_TO_LIGHT_mat4x3 = glGetUniformLocation(program, "OBJECT_TO_LIGHT");
 	NORMAL_TO_LIGHT_mat3 = glGetUniformLocation(program, "NORMAL_TO_LIGHT");
+	WORLD_TO_CLIP_mat4 = glGetUniformLocation(program, "WORLD_TO_CLIP");
+	WORLD_TO_LIGHT_mat4x3 = glGetUniformLocation(program, "WORLD_TO_LIGHT");
+
+	POSITION_SCALE_vec3 = glGetUniformLocation(program, "POSITION_SCALE");
+	POSITION_OFFSET_vec3 = glGetUniformLocation(program, "POSITION_OFFSET");
+	OCTAHEDRAL_NORMALS_bool = glGetUniformLocation(program, "OCTAHEDRAL_NORMALS");
 
 	LIGHT_TYPE_int = glGetUniformLocation(program, "LIGHT_TYPE");
 	LIGHT_LOCATION_vec3 = glGetUniformLocation(program, "LIGHT_LOCATION");
@@ -134,6 +193,11 @@ LitColorTextureProgram::LitColorTextureProgram() {
 
 	glUniform1i(TEX_sampler2D, 0); //set TEX to sample from GL_TEXTURE0
 
+	//default to no vertex decoding (Scene::draw sets these per-draw):
+	glUniform3f(POSITION_SCALE_vec3, 1.0f, 1.0f, 1.0f);
+	glUniform3f(POSITION_OFFSET_vec3, 0.0f, 0.0f, 0.0f);
+	glUniform1i(OCTAHEDRAL_NORMALS_bool, 0);
+
 	glUseProgram(0); //unbind program -- glUniform* calls refer to ??? now
 }
 
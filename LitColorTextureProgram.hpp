@@ -6,7 +6,13 @@
 
 //Shader program that draws transformed, lit, textured vertices tinted with vertex colors:
 struct LitColorTextureProgram {
-	LitColorTextureProgram();
+	//The 'Instanced' variant reads the object-to-world matrix from a per-instance attribute
+	// (for Scene::InstancedDrawable) instead of from per-object uniforms:
+	enum Variant {
+		Regular,
+		Instanced
+	};
+	LitColorTextureProgram(Variant variant = Regular);
 	~LitColorTextureProgram();
 
 	GLuint program = 0;
@@ -16,11 +22,21 @@ struct LitColorTextureProgram {
 	GLuint Normal_vec3 = -1U;
 	GLuint Color_vec4 = -1U;
 	GLuint TexCoord_vec2 = -1U;
+	//(Instanced only) per-instance attribute location:
+	GLuint OBJECT_TO_WORLD_mat4x3 = -1U;
 
 	//Uniform (per-invocation variable) locations:
 	GLuint OBJECT_TO_CLIP_mat4 = -1U;
 	GLuint OBJECT_TO_LIGHT_mat4x3 = -1U;
 	GLuint NORMAL_TO_LIGHT_mat3 = -1U;
+	//(Instanced only):
+	GLuint WORLD_TO_CLIP_mat4 = -1U;
+	GLuint WORLD_TO_LIGHT_mat4x3 = -1U;
+
+	//vertex decoding (see mesh_decode_glsl in Mesh.hpp):
+	GLuint POSITION_SCALE_vec3 = -1U;
+	GLuint POSITION_OFFSET_vec3 = -1U;
+	GLuint OCTAHEDRAL_NORMALS_bool = -1U;
 
 	//lighting:
 	GLuint LIGHT_TYPE_int = -1U;
@@ -34,7 +50,12 @@ struct LitColorTextureProgram {
 };
 
 extern Load< LitColorTextureProgram > lit_color_texture_program;
+extern Load< LitColorTextureProgram > lit_color_texture_instanced_program;
 
 //For convenient scene-graph setup, copy this object:
 // NOTE: by default, has texture bound to 1-pixel white texture -- so it's okay to use with vertex-color-only meshes.
 extern Scene::Drawable::Pipeline lit_color_texture_program_pipeline;
+
+//Same as above, for Scene::InstancedDrawable:
+// NOTE: vao and instance_buffer still need to be set; see MeshBuffer::make_vao_for_program.
+extern Scene::InstancedDrawable::Pipeline lit_color_texture_instanced_program_pipeline;
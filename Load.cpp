@@ -1,32 +1,360 @@
 #include "Load.hpp"
+#include "Trace.hpp"
 
-#include <array>
-#include <list>
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
 
 namespace {
-	std::array< std::list< std::function< void() > >, MaxLoadTag > &get_load_lists() {
-		static std::array< std::list< std::function< void() > >, MaxLoadTag > load_lists;
-		return load_lists;
+	struct LoadJob {
+		LoadTag tag;
+		std::vector< LoadNode const * > after; //(resolved to indices by call_load_functions)
+		std::function< std::function< void() >() > prepare; //(empty for plain load functions)
+		std::function< void() > finish; //(plain load function, or set by 'prepare')
+	};
+
+	std::vector< LoadJob > &get_load_jobs() {
+		static std::vector< LoadJob > load_jobs;
+		return load_jobs;
+	}
+
+	//-- startup profiling --
+
+	//seconds since the first call:
+	double startup_time() {
+		static auto const start = std::chrono::steady_clock::now();
+		return std::chrono::duration< double >(std::chrono::steady_clock::now() - start).count();
+	}
+
+	//what each load did (same indices as load jobs; kept after the jobs are done):
+	struct LoadRecord {
+		char const *file;
+		uint32_t line;
+		LoadTag tag;
+		double prepare_begin = 0.0, prepare_end = 0.0; //(both zero for plain load functions)
+		uint32_t prepare_thread = 0; //(workers are numbered from 1; the main thread is 0)
+		double finish_begin = 0.0, finish_end = 0.0;
+		size_t bytes_read = 0;
+		size_t bytes_uploaded = 0;
+	};
+
+	std::vector< LoadRecord > &get_load_records() {
+		static std::vector< LoadRecord > load_records;
+		return load_records;
+	}
+
+	//record of the load stage running on this thread (for load_note_*):
+	thread_local LoadRecord *current_record = nullptr;
+
+	struct StartupMark {
+		std::string what;
+		double time;
+	};
+
+	std::vector< StartupMark > &get_startup_marks() {
+		static std::vector< StartupMark > startup_marks;
+		return startup_marks;
+	}
+
+	std::string get_environment(char const *name) {
+	#ifdef _WIN32
+		char *value = nullptr;
+		size_t size = 0;
+		if (_dupenv_s(&value, &size, name) != 0 || value == nullptr) return "";
+		std::string ret = value;
+		free(value);
+		return ret;
+	#else
+		char const *value = std::getenv(name);
+		return (value ? value : "");
+	#endif
 	}
 }
 
-void add_load_function(LoadTag tag, std::function< void() > const &fn) {
-	auto &load_lists = get_load_lists();
-	assert(tag < load_lists.size());
-	load_lists[tag].emplace_back(fn);
+uint32_t add_load_function(LoadTag tag, std::function< void() > const &fn, char const *file, uint32_t line) {
+	assert(tag < MaxLoadTag);
+	auto &load_jobs = get_load_jobs();
+	load_jobs.emplace_back(LoadJob{tag, {}, nullptr, fn});
+	get_load_records().emplace_back(LoadRecord{file, line, tag});
+	return uint32_t(load_jobs.size() - 1);
+}
+
+uint32_t add_load_job(LoadTag tag, std::vector< LoadNode const * > const &after, std::function< std::function< void() >() > const &prepare, char const *file, uint32_t line) {
+	assert(tag < MaxLoadTag);
+	assert(prepare);
+	auto &load_jobs = get_load_jobs();
+	load_jobs.emplace_back(LoadJob{tag, after, prepare, nullptr});
+	get_load_records().emplace_back(LoadRecord{file, line, tag});
+	return uint32_t(load_jobs.size() - 1);
 }
 
 void call_load_functions() {
 	static bool has_been_called = false;
 	assert(!has_been_called && "call_load_functions should only be called *once*");
 	has_been_called = true;
+	TraceScope trace("call_load_functions");
+
+	startup_mark("call_load_functions");
+
+	auto &load_jobs = get_load_jobs();
+	auto &load_records = get_load_records();
+	uint32_t count = uint32_t(load_jobs.size());
+	assert(load_records.size() == count);
+
+	//work out what each job waits for before it can finish:
+	// (two-stage jobs' 'after' lists also gate their 'prepare' stage)
+	std::vector< std::vector< uint32_t > > waits_for(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		LoadJob const &job = load_jobs[i];
+		for (LoadNode const *node : job.after) {
+			if (node->load_index >= count) {
+				throw std::runtime_error("Load depends on a Load that was never added.");
+			}
+			waits_for[i].emplace_back(node->load_index);
+		}
+	}
+
+	//state of every job (guarded by 'mutex' while workers are running):
+	enum State : uint8_t { Waiting, Preparing, Prepared, Finished };
+	std::vector< State > state(count, Waiting);
+	std::vector< uint32_t > finished_by_tag(MaxLoadTag, 0), total_by_tag(MaxLoadTag, 0);
+	for (LoadJob const &job : load_jobs) total_by_tag[job.tag] += 1;
+
+	std::mutex mutex;
+	std::condition_variable work_ready; //(signalled when 'to_prepare' grows or on shutdown)
+	std::condition_variable work_done; //(signalled when a job is Prepared)
+	std::deque< uint32_t > to_prepare;
+	std::exception_ptr error;
+	bool shutdown = false;
+
+	auto worker = [&](uint32_t worker_index) {
+		std::unique_lock< std::mutex > lock(mutex);
+		while (true) {
+			work_ready.wait(lock, [&]() { return shutdown || !to_prepare.empty(); });
+			if (shutdown) return;
+			uint32_t i = to_prepare.front();
+			to_prepare.pop_front();
+			std::function< std::function< void() >() > prepare = load_jobs[i].prepare;
+
+			lock.unlock();
+			LoadRecord &record = load_records[i];
+			record.prepare_thread = worker_index;
+			record.prepare_begin = startup_time();
+			current_record = &record;
+			std::function< void() > finish;
+			std::exception_ptr prepare_error;
+			try {
+				TraceScope trace("load prepare");
+				finish = prepare();
+			} catch (...) {
+				prepare_error = std::current_exception();
+			}
+			current_record = nullptr;
+			record.prepare_end = startup_time();
+			lock.lock();
+
+			if (prepare_error && !error) error = prepare_error;
+			load_jobs[i].finish = finish;
+			state[i] = Prepared;
+			work_done.notify_one();
+		}
+	};
+
+	//one thread stays free for the main thread, which does all the OpenGL work:
+	uint32_t thread_count = std::max(2U, std::thread::hardware_concurrency()) - 1U;
+	std::vector< std::thread > workers;
+
+	//stop workers on the way out, even if a load function throws:
+	struct Join {
+		std::function< void() > fn;
+		~Join() { fn(); }
+	} join{[&]() {
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			shutdown = true;
+		}
+		work_ready.notify_all();
+		for (auto &thread : workers) thread.join();
+	}};
+
+	//is everything job 'i' has to wait for finished? (call with lock held)
+	auto all_finished = [&](uint32_t i) {
+		for (uint32_t j : waits_for[i]) {
+			if (state[j] != Finished) return false;
+		}
+		return true;
+	};
+	//have all jobs with tags before 'tag' finished?
+	auto earlier_tags_finished = [&](LoadTag tag) {
+		for (uint32_t t = 0; t < tag; ++t) {
+			if (finished_by_tag[t] != total_by_tag[t]) return false;
+		}
+		return true;
+	};
+
+	std::unique_lock< std::mutex > lock(mutex);
+	uint32_t finished = 0;
+	while (finished < count) {
+		if (error) std::rethrow_exception(error);
+
+		//start preparing every two-stage job whose dependencies are done:
+		bool started = false;
+		for (uint32_t i = 0; i < count; ++i) {
+			if (state[i] == Waiting && load_jobs[i].prepare && all_finished(i)) {
+				state[i] = Preparing;
+				to_prepare.emplace_back(i);
+				started = true;
+				if (workers.size() < thread_count) workers.emplace_back(worker, uint32_t(workers.size() + 1));
+			}
+		}
+		if (started) work_ready.notify_all();
+
+		//find the first job that can finish on this thread:
+		// (plain functions finish in the order they were added within each tag, and after two-stage jobs added before them)
+		uint32_t next = count;
+		for (uint32_t i = 0; i < count && next == count; ++i) {
+			LoadJob const &job = load_jobs[i];
+			if (state[i] == Finished || !earlier_tags_finished(job.tag)) continue;
+			if (!job.prepare) {
+				bool ready = true;
+				for (uint32_t j = 0; j < i; ++j) {
+					if (load_jobs[j].tag <= job.tag && state[j] != Finished) ready = false;
+				}
+				if (ready) next = i;
+			} else if (state[i] == Prepared) {
+				next = i;
+			}
+		}
+
+		if (next == count) {
+			//nothing to do here until a worker finishes preparing something:
+			bool in_flight = false;
+			for (uint32_t i = 0; i < count; ++i) {
+				if (state[i] == Preparing) in_flight = true;
+			}
+			if (!in_flight) {
+				throw std::runtime_error("Loads can't finish (is there a dependency cycle?)");
+			}
+			work_done.wait(lock);
+			continue;
+		}
 
-	auto &load_lists = get_load_lists();
-	for (auto &fn_list : load_lists) {
-		while (!fn_list.empty()) {
-			(*fn_list.begin())(); //call first function in the list
-			fn_list.pop_front(); //remove from list
+		//call it (without holding the lock, so workers can keep going):
+		std::function< void() > finish = load_jobs[next].finish;
+		lock.unlock();
+		LoadRecord &record = load_records[next];
+		record.finish_begin = startup_time();
+		current_record = &record;
+		struct Clear { ~Clear() { current_record = nullptr; } } clear; //(even if finish() throws)
+		{
+			TraceScope trace("load finish");
+			finish();
 		}
+		record.finish_end = startup_time();
+		lock.lock();
+
+		state[next] = Finished;
+		finished_by_tag[load_jobs[next].tag] += 1;
+		finished += 1;
+	}
+	lock.unlock();
+
+	load_jobs.clear();
+	startup_mark("loads done");
+}
+
+void load_note_read(size_t bytes) {
+	if (current_record) current_record->bytes_read += bytes;
+}
+
+void load_note_upload(size_t bytes) {
+	if (current_record) current_record->bytes_uploaded += bytes;
+}
+
+void startup_mark(char const *what) {
+	get_startup_marks().emplace_back(StartupMark{what, startup_time()});
+}
+
+void startup_report() {
+	std::string trace_filename = get_environment("STARTUP_PROFILE");
+	if (trace_filename.empty()) return;
+
+	auto const &marks = get_startup_marks();
+	auto const &records = get_load_records();
+
+	//name a load by where it was declared:
+	auto name = [](LoadRecord const &record) {
+		std::string file = record.file;
+		size_t slash = file.find_last_of("/\\");
+		if (slash != std::string::npos) file = file.substr(slash + 1);
+		return file + ":" + std::to_string(record.line);
+	};
+	auto ms = [](double seconds) {
+		char buffer[32];
+		std::snprintf(buffer, sizeof(buffer), "%9.2f", seconds * 1000.0);
+		return std::string(buffer);
+	};
+	auto kb = [](size_t bytes) {
+		char buffer[32];
+		std::snprintf(buffer, sizeof(buffer), "%9.1f", bytes / 1024.0);
+		return std::string(buffer);
+	};
+
+	std::cout << "---- startup (ms since '" << (marks.empty() ? "" : marks[0].what) << "') ----\n";
+	for (auto const &mark : marks) {
+		std::cout << ms(mark.time) << "  " << mark.what << "\n";
+	}
+
+	//loads, longest first, by time spent in either stage:
+	std::vector< LoadRecord const * > sorted;
+	for (auto const &record : records) sorted.emplace_back(&record);
+	auto busy = [](LoadRecord const *r) { return (r->prepare_end - r->prepare_begin) + (r->finish_end - r->finish_begin); };
+	std::stable_sort(sorted.begin(), sorted.end(), [&](LoadRecord const *a, LoadRecord const *b) { return busy(a) > busy(b); });
+
+	std::cout << "---- loads, slowest first ----\n";
+	std::cout << " total ms prepare ms  finish ms    read KB  upload KB  where\n";
+	for (LoadRecord const *r : sorted) {
+		std::cout << ms(busy(r)) << "  " << ms(r->prepare_end - r->prepare_begin) << "  " << ms(r->finish_end - r->finish_begin)
+			<< "  " << kb(r->bytes_read) << "  " << kb(r->bytes_uploaded) << "  " << name(*r) << "\n";
+	}
+	std::cout.flush();
+
+	//Chrome trace event format (https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU):
+	std::ofstream trace(trace_filename, std::ios::binary);
+	trace << "{\"traceEvents\":[\n";
+	trace << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"main\"}}";
+	uint32_t workers = 0;
+	for (auto const &r : records) workers = std::max(workers, r.prepare_thread);
+	for (uint32_t w = 1; w <= workers; ++w) {
+		trace << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << w << ",\"args\":{\"name\":\"load worker " << w << "\"}}";
+	}
+	auto us = [](double seconds) { return std::to_string(int64_t(seconds * 1e6)); };
+	for (auto const &mark : marks) {
+		trace << ",\n{\"name\":\"" << mark.what << "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":" << us(mark.time) << "}";
+	}
+	for (auto const &r : records) {
+		std::string args = "{\"read_bytes\":" + std::to_string(r.bytes_read) + ",\"upload_bytes\":" + std::to_string(r.bytes_uploaded) + "}";
+		if (r.prepare_end > r.prepare_begin) {
+			trace << ",\n{\"name\":\"" << name(r) << " prepare\",\"cat\":\"load\",\"ph\":\"X\",\"pid\":1,\"tid\":" << r.prepare_thread
+			      << ",\"ts\":" << us(r.prepare_begin) << ",\"dur\":" << us(r.prepare_end - r.prepare_begin) << ",\"args\":" << args << "}";
+		}
+		trace << ",\n{\"name\":\"" << name(r) << "\",\"cat\":\"load\",\"ph\":\"X\",\"pid\":1,\"tid\":0"
+		      << ",\"ts\":" << us(r.finish_begin) << ",\"dur\":" << us(r.finish_end - r.finish_begin) << ",\"args\":" << args << "}";
+	}
+	trace << "\n]}\n";
+	if (!trace) {
+		std::cerr << "WARNING: failed to write startup trace to '" << trace_filename << "'." << std::endl;
+	} else {
+		std::cout << "Wrote startup trace to '" << trace_filename << "'." << std::endl;
 	}
 }
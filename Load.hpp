@@ -20,11 +20,42 @@
  * These functions are grouped by 'tags', which allow some sequencing of calls.
  * (particularly, this is useful for loading large data blobs [e.g. Meshes] before looking up individual elements within them.)
  *
+ * Loads that do a lot of work that doesn't need OpenGL (reading and parsing files, etc.) can be split into two stages:
+ *
+ * //at global scope:
+ * Load< MeshBuffer > meshes(LoadTagDefault, {&lit_color_texture_program}, []() {
+ *     //runs on a worker thread, once every Load in the list above has loaded:
+ *     auto prepared = MeshBuffer::prepare(data_path("meshes.pnct"));
+ *     return [prepared]() -> MeshBuffer const * {
+ *         //runs on the main (OpenGL) thread:
+ *         return new MeshBuffer(*prepared);
+ *     };
+ * });
+ *
+ * call_load_functions() runs the first stages of all such loads in parallel on a pool of threads,
+ *  so startup takes about as long as the slowest chain of dependent loads, not the sum of all of them.
+ *
+ * Ordering rules:
+ *  - a two-stage load's first stage starts once every Load it lists has loaded;
+ *    its second stage also waits for every load with an earlier tag.
+ *  - a plain load function (or single-function Load) runs on the main thread after every load
+ *    with an earlier tag, and every load added before it with the same tag (just as if all loads ran in order).
+ *
+ * Every load's timing is recorded, along with where it was declared and the bytes it read and
+ *  uploaded (as reported by load_note_read / load_note_upload, which MeshBuffer and Scene call).
+ *  If the environment variable STARTUP_PROFILE is set, startup_report() prints a table of loads,
+ *  slowest first, and writes them as a Chrome trace (chrome://tracing, ui.perfetto.dev) to the
+ *  file it names:
+ *
+ *  $ STARTUP_PROFILE=startup.json dist/game
+ *
  */
 
 #include <functional>
 #include <stdexcept>
+#include <cstddef>
 #include <cstdint>
+#include <vector>
 
 
 enum LoadTag : uint32_t {
@@ -34,30 +65,71 @@ enum LoadTag : uint32_t {
 	MaxLoadTag //<-- just used to track # of load tags
 };
 
+//Every Load<> is a node in the graph of loads, which other loads can list as dependencies:
+struct LoadNode {
+	uint32_t load_index = -1U; //(set when the load is added)
+};
+
 //Add a function to an internal list of loading functions:
 // (only call *before* "call_load_functions()")
-void add_load_function(LoadTag tag, std::function< void() > const &fn);
+// returns an index for LoadNode::load_index
+// ('file' and 'line' default to the caller's, and identify the load in the startup report)
+uint32_t add_load_function(LoadTag tag, std::function< void() > const &fn,
+	char const *file = __builtin_FILE(), uint32_t line = __builtin_LINE());
+
+//Add a two-stage loading job:
+// 'prepare' is called on a worker thread once all of 'after' have loaded, and must not use OpenGL;
+// the function it returns is called on the main thread.
+// (only call *before* "call_load_functions()"; the LoadNodes in 'after' may not be constructed yet)
+uint32_t add_load_job(LoadTag tag, std::vector< LoadNode const * > const &after, std::function< std::function< void() >() > const &prepare,
+	char const *file = __builtin_FILE(), uint32_t line = __builtin_LINE());
 
 //Call all loading functions:
 // (loading functions may throw exceptions if they fail.)
 // (only call *once*)
 void call_load_functions();
 
+//Credit bytes read from files / uploaded to the GPU to the load running on this thread (if any):
+void load_note_read(size_t bytes);
+void load_note_upload(size_t bytes);
+
+//Record a startup milestone (e.g., "context created") for the startup report:
+// (times are measured from the first mark)
+void startup_mark(char const *what);
+
+//Print the startup report and write the trace, if STARTUP_PROFILE is set (see above):
+void startup_report();
+
 
 //work-around for MSVC not accepting this as a lambda:
 template< typename T >
 T const *new_T() { return new T; }
 
 template< typename T >
-struct Load {
+struct Load : LoadNode {
 	//Constructing a Load< T > adds the passed function to the list of functions to call:
-	Load(LoadTag tag, const std::function< T const *() > &load_fn = new_T< T >) : value(nullptr) {
-		add_load_function(tag, [this,load_fn](){
+	Load(LoadTag tag, const std::function< T const *() > &load_fn = new_T< T >,
+		char const *file = __builtin_FILE(), uint32_t line = __builtin_LINE()) : value(nullptr) {
+		load_index = add_load_function(tag, [this,load_fn](){
 			this->value = load_fn();
 			if (!(this->value)) {
 				throw std::runtime_error("Loading failed.");
 			}
-		});
+		}, file, line);
+	}
+
+	//...or adds a two-stage job (see above): prepare_fn runs on a worker thread, the function it returns on the main thread:
+	Load(LoadTag tag, std::vector< LoadNode const * > const &after, const std::function< std::function< T const *() >() > &prepare_fn,
+		char const *file = __builtin_FILE(), uint32_t line = __builtin_LINE()) : value(nullptr) {
+		load_index = add_load_job(tag, after, [this,prepare_fn]() -> std::function< void() > {
+			std::function< T const *() > finish_fn = prepare_fn();
+			return [this,finish_fn](){
+				this->value = finish_fn();
+				if (!(this->value)) {
+					throw std::runtime_error("Loading failed.");
+				}
+			};
+		}, file, line);
 	}
 
 	//Make a "Load< T >" behave like a "T const *":
@@ -73,10 +145,11 @@ struct Load {
 //Specialization:
 //Load< void > just calls a function:
 template< >
-struct Load< void > {
+struct Load< void > : LoadNode {
 	//Constructing a Load< T > adds the passed function to the list of functions to call:
-	Load( LoadTag tag, const std::function< void() > &load_fn) {
-		add_load_function(tag, load_fn);
+	Load( LoadTag tag, const std::function< void() > &load_fn,
+		char const *file = __builtin_FILE(), uint32_t line = __builtin_LINE()) {
+		load_index = add_load_function(tag, load_fn, file, line);
 	}
 };
 
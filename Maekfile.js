@@ -54,6 +54,7 @@ if (maek.OS === "windows") {
 	maek.options.LINKLibs.push(
 		//linker flags for nest libraries:
 		`-L${NEST_LIBS}/SDL2/lib`, `-lSDL2`, `-lm`, `-ldl`, `-lasound`, `-lpthread`, `-lX11`, `-lXext`, `-lpthread`, `-lrt`, `-lGL`, //the output of sdl-config --static-libs
+		`-lEGL`, //for headless rendering (HeadlessContext.cpp)
 		`-L${NEST_LIBS}/libpng/lib`, `-lpng`,
 		`-L${NEST_LIBS}/zlib/lib`, `-lz`
 	);
@@ -95,7 +96,9 @@ if (maek.OS === 'windows') {
 //returns objFile: objFileBase + a platform-dependant suffix ('.o' or '.obj')
 const game_names = [
 	maek.CPP('PlayMode.cpp'),
+	maek.CPP('InputRecording.cpp'),
 	maek.CPP('main.cpp'),
+	maek.CPP('HeadlessContext.cpp'),
 	maek.CPP('LitColorTextureProgram.cpp')
 	//, maek.CPP('ColorTextureProgram.cpp')  //not used right now, but you might want it
 ];
@@ -112,7 +115,18 @@ const common_names = [
 	maek.CPP('gl_compile_program.cpp'),
 	maek.CPP('Mode.cpp'),
 	maek.CPP('GL.cpp'),
-	maek.CPP('Load.cpp')
+	maek.CPP('Load.cpp'),
+	maek.CPP('RenderQueue.cpp'),
+	maek.CPP('Frustum.cpp'),
+	maek.CPP('MappedFile.cpp'),
+	maek.CPP('AssetPack.cpp'),
+	maek.CPP('ChunkFile.cpp'),
+	maek.CPP('chunk_compression.cpp'),
+	maek.CPP('AssetWatch.cpp'),
+	maek.CPP('HotReload.cpp'),
+	maek.CPP('FrameCapture.cpp'),
+	maek.CPP('FrameProfiler.cpp'),
+	maek.CPP('Trace.cpp')
 ];
 
 const show_mesh_names = [
@@ -127,16 +141,71 @@ const show_scene_names = [
 	maek.CPP('ShowSceneMode.cpp')
 ];
 
+//snow simulation code (shared by the game and the benchmarks; doesn't need GL):
+const snow_names = [
+	maek.CPP('SnowFall.cpp'),
+	maek.CPP('SnowWorld.cpp'),
+	maek.CPP('SnowBatch.cpp'),
+	maek.CPP('Random.cpp')
+];
+
+const bench_snow_names = [
+	maek.CPP('bench-snow.cpp')
+];
+
+const bench_batch_names = [
+	maek.CPP('bench-batch.cpp')
+];
+
+const bench_scene_names = [
+	maek.CPP('bench-scene.cpp')
+];
+
+//chunk file loading benchmark (doesn't need GL, so it links only the file-reading code):
+const bench_load_names = [
+	maek.CPP('bench-load.cpp'),
+	maek.CPP('ChunkFile.cpp'),
+	maek.CPP('chunk_compression.cpp'),
+	maek.CPP('MappedFile.cpp'),
+	maek.CPP('AssetPack.cpp'),
+	maek.CPP('data_path.cpp')
+];
+
+//offline tool that converts triangle-soup .pnct files to indexed ones:
+const index_meshes_names = [
+	maek.CPP('index-meshes.cpp'),
+	maek.CPP('MeshOptimize.cpp'),
+	maek.CPP('ChunkFile.cpp'),
+	maek.CPP('chunk_compression.cpp'),
+	maek.CPP('MappedFile.cpp'),
+	maek.CPP('AssetPack.cpp'),
+	maek.CPP('data_path.cpp')
+];
+
+//offline tool that bundles game data into one AssetPack file:
+const pack_assets_names = [
+	maek.CPP('pack-assets.cpp'),
+	maek.CPP('AssetPack.cpp'),
+	maek.CPP('MappedFile.cpp'),
+	maek.CPP('data_path.cpp')
+];
+
 //the '[exeFile =] LINK(objFiles, exeFileBase, [, options])' links an array of objects into an executable:
 // objFiles: array of objects to link
 // exeFileBase: name of executable file to produce
 //returns exeFile: exeFileBase + a platform-dependant suffix (e.g., '.exe' on windows)
-const game_exe = maek.LINK([...game_names, ...common_names], 'dist/game');
+const game_exe = maek.LINK([...game_names, ...snow_names, ...common_names], 'dist/game');
 const show_meshes_exe = maek.LINK([...show_mesh_names, ...common_names], 'scenes/show-meshes');
 const show_scene_exe = maek.LINK([...show_scene_names, ...common_names], 'scenes/show-scene');
+const bench_snow_exe = maek.LINK([...bench_snow_names, ...snow_names], 'bench/bench-snow');
+const bench_batch_exe = maek.LINK([...bench_batch_names, ...snow_names], 'bench/bench-batch');
+const bench_scene_exe = maek.LINK([...bench_scene_names, ...common_names], 'bench/bench-scene');
+const bench_load_exe = maek.LINK([...bench_load_names], 'bench/bench-load');
+const index_meshes_exe = maek.LINK([...index_meshes_names], 'scenes/index-meshes');
+const pack_assets_exe = maek.LINK([...pack_assets_names], 'scenes/pack-assets');
 
 //set the default target to the game (and copy the readme files):
-maek.TARGETS = [game_exe, show_meshes_exe, show_scene_exe, ...copies];
+maek.TARGETS = [game_exe, show_meshes_exe, show_scene_exe, bench_snow_exe, bench_batch_exe, bench_scene_exe, bench_load_exe, index_meshes_exe, pack_assets_exe, ...copies];
 
 //Note that tasks that produce ':abstract targets' are never cached.
 // This is similar to how .PHONY targets behave in make.
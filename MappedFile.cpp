@@ -0,0 +1,76 @@
+#include "MappedFile.hpp"
+
+#include <stdexcept>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(std::string const &filename) {
+	#if defined(_WIN32)
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Failed to open '" + filename + "'");
+	}
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size)) {
+		CloseHandle(file);
+		throw std::runtime_error("Failed to get size of '" + filename + "'");
+	}
+	size = size_t(file_size.QuadPart);
+
+	if (size != 0) { //(empty files can't be mapped)
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		void *view = (mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL);
+		if (!view) {
+			if (mapping) CloseHandle(mapping);
+			CloseHandle(file);
+			throw std::runtime_error("Failed to map '" + filename + "'");
+		}
+		mapping_handle = mapping;
+		data = reinterpret_cast< char const * >(view);
+	}
+	file_handle = file;
+	#else
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("Failed to open '" + filename + "'");
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		close(fd);
+		throw std::runtime_error("Failed to get size of '" + filename + "'");
+	}
+	size = size_t(info.st_size);
+
+	if (size != 0) { //(empty files can't be mapped)
+		void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped == MAP_FAILED) {
+			close(fd);
+			throw std::runtime_error("Failed to map '" + filename + "'");
+		}
+		//files are mostly read front to back, so ask for read-ahead:
+		madvise(mapped, size, MADV_SEQUENTIAL);
+		data = reinterpret_cast< char const * >(mapped);
+	}
+	close(fd); //(the mapping keeps its own reference to the file)
+	#endif
+}
+
+MappedFile::~MappedFile() {
+	#if defined(_WIN32)
+	if (data) UnmapViewOfFile(data);
+	if (mapping_handle) CloseHandle(mapping_handle);
+	if (file_handle) CloseHandle(file_handle);
+	#else
+	if (data) munmap(const_cast< char * >(data), size);
+	#endif
+	data = nullptr;
+}
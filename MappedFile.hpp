@@ -0,0 +1,33 @@
+#pragma once
+
+/*
+ * A MappedFile is a whole file mapped read-only into memory
+ *  (mmap on Linux/macOS, a file mapping on Windows).
+ *
+ * The mapping starts on a page boundary and stays valid until the
+ *  MappedFile is destroyed. Empty files have data == nullptr.
+ *
+ * Used by ChunkFile and AssetPack.
+ *
+ */
+
+#include <cstddef>
+#include <string>
+
+struct MappedFile {
+	//map the whole file (throws if it can't be opened or mapped):
+	explicit MappedFile(std::string const &filename);
+	~MappedFile();
+
+	MappedFile(MappedFile const &) = delete;
+	MappedFile &operator=(MappedFile const &) = delete;
+
+	char const *data = nullptr;
+	size_t size = 0;
+
+	//-- internals ---
+	#if defined(_WIN32)
+	void *file_handle = nullptr;
+	void *mapping_handle = nullptr;
+	#endif
+};
@@ -1,20 +1,62 @@
 #include "Mesh.hpp"
-#include "read_write_chunk.hpp"
+#include "ChunkFile.hpp"
+#include "Load.hpp"
+#include "Trace.hpp"
 
 #include <glm/glm.hpp>
 
+#include <algorithm>
 #include <stdexcept>
-#include <fstream>
 #include <iostream>
 #include <vector>
 #include <string>
 #include <set>
+#include <memory>
 #include <cstddef>
 
-MeshBuffer::MeshBuffer(std::string const &filename) {
-	glGenBuffers(1, &buffer);
+char const *mesh_decode_glsl =
+	"uniform vec3 POSITION_SCALE;\n"
+	"uniform vec3 POSITION_OFFSET;\n"
+	"uniform bool OCTAHEDRAL_NORMALS;\n"
+	"vec4 decode_position(vec4 p) {\n"
+	"	return vec4(POSITION_SCALE * p.xyz + POSITION_OFFSET, 1.0);\n"
+	"}\n"
+	"vec3 decode_normal(vec3 n) {\n"
+	"	if (!OCTAHEDRAL_NORMALS) return n;\n"
+	"	vec3 o = vec3(n.xy, 1.0 - abs(n.x) - abs(n.y));\n" //upper hemisphere maps directly...
+	"	float t = max(-o.z, 0.0);\n" //...lower hemisphere was folded over the diagonals
+	"	o.x += (o.x >= 0.0 ? -t : t);\n"
+	"	o.y += (o.y >= 0.0 ? -t : t);\n"
+	"	return normalize(o);\n"
+	"}\n"
+;
+
+//everything MeshBuffer needs from its file, read and checked but not yet uploaded:
+struct MeshBuffer::Prepared {
+	std::string filename;
+	std::unique_ptr< ChunkFile > file; //(vertex and element data are read in place from here, unless copied to 'copied_data')
+	char const *vertex_data = nullptr;
+	size_t vertex_bytes = 0;
+	void const *element_data = nullptr; //(points into 'file', 'short_elements', or 'copied_data')
+	size_t element_bytes = 0;
+	std::vector< uint16_t > short_elements;
+	std::vector< char > copied_data; //vertex data, then (32-bit) element data, if prepared with copy_data
+	GLenum index_type = GL_NONE;
+	Attrib Position, Normal, Color, TexCoord;
+	std::map< std::string, Mesh > meshes;
+};
+
+std::shared_ptr< MeshBuffer::Prepared const > MeshBuffer::prepare(std::string const &filename, bool copy_data) {
+	TraceScope trace("MeshBuffer::prepare");
+	auto ret = std::make_shared< Prepared >();
+	Prepared &prepared = *ret;
+	prepared.filename = filename;
 
-	std::ifstream file(filename, std::ios::binary);
+	//(chunks are read in place from the mapped file, in whatever order they were written; see ChunkFile.hpp)
+	prepared.file = std::make_unique< ChunkFile >(filename);
+	ChunkFile &file = *prepared.file;
+	load_note_read(file.size);
+	file.decompress_all(); //(vertex and element chunks may be compressed; decode them side by side)
 
 	GLuint total = 0;
 
@@ -25,77 +67,181 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		glm::vec2 TexCoord;
 	};
 	static_assert(sizeof(Vertex) == 3*4+3*4+4*1+2*4, "Vertex is packed.");
-	std::vector< Vertex > data;
+	ChunkFile::Span< Vertex > data;
+	ChunkFile::Span< QuantizedVertex > quantized_data; //(read instead of 'data' from quantized files)
+	bool quantized = false;
+	ChunkFile::Span< uint32_t > elements; //(only present in indexed files)
+	GLenum &index_type = prepared.index_type;
 
-	//read + upload data chunk:
+	//read data chunk:
 	if (filename.size() >= 5 && filename.substr(filename.size()-5) == ".pnct") {
-		read_chunk(file, "pnct", &data);
+		if (file.has("qnct")) {
+			quantized_data = file.find< QuantizedVertex >("qnct");
+			quantized = true;
+
+			prepared.vertex_data = reinterpret_cast< char const * >(quantized_data.data());
+			prepared.vertex_bytes = quantized_data.size() * sizeof(QuantizedVertex);
+
+			total = GLuint(quantized_data.size());
 
-		//upload data:
-		glBindBuffer(GL_ARRAY_BUFFER, buffer);
-		glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(Vertex), data.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+			//store attrib locations:
+			// (positions and normals still need the decoding described in Mesh)
+			prepared.Position = Attrib(3, GL_SHORT, GL_TRUE, sizeof(QuantizedVertex), offsetof(QuantizedVertex, Position));
+			prepared.Normal = Attrib(2, GL_SHORT, GL_TRUE, sizeof(QuantizedVertex), offsetof(QuantizedVertex, Normal));
+			prepared.Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(QuantizedVertex), offsetof(QuantizedVertex, Color));
+			prepared.TexCoord = Attrib(2, GL_HALF_FLOAT, GL_FALSE, sizeof(QuantizedVertex), offsetof(QuantizedVertex, TexCoord));
+		} else {
+			data = file.find< Vertex >("pnct");
 
-		total = GLuint(data.size()); //store total for later checks on index
+			prepared.vertex_data = reinterpret_cast< char const * >(data.data());
+			prepared.vertex_bytes = data.size() * sizeof(Vertex);
+
+			total = GLuint(data.size()); //store total for later checks on index
+
+			//store attrib locations:
+			prepared.Position = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Position));
+			prepared.Normal = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Normal));
+			prepared.Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Color));
+			prepared.TexCoord = Attrib(2, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, TexCoord));
+		}
+
+		//indexed files (see index-meshes.cpp) also have an element chunk:
+		if (file.has("idx1")) {
+			elements = file.find< uint32_t >("idx1");
+			for (uint32_t e : elements) {
+				if (e >= total) throw std::runtime_error("element chunk has out-of-range vertex index");
+			}
 
-		//store attrib locations:
-		Position = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Position));
-		Normal = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Normal));
-		Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Color));
-		TexCoord = Attrib(2, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, TexCoord));
+			//elements are uploaded as 16-bit indices if they fit:
+			if (total <= 0x10000) {
+				prepared.short_elements.assign(elements.begin(), elements.end());
+				prepared.element_data = prepared.short_elements.data();
+				prepared.element_bytes = prepared.short_elements.size() * sizeof(uint16_t);
+				index_type = GL_UNSIGNED_SHORT;
+			} else {
+				prepared.element_data = elements.data();
+				prepared.element_bytes = elements.size() * sizeof(uint32_t);
+				index_type = GL_UNSIGNED_INT;
+			}
+		}
 	} else {
 		throw std::runtime_error("Unknown file type '" + filename + "'");
 	}
 
-	std::vector< char > strings;
-	read_chunk(file, "str0", &strings);
+	ChunkFile::Span< char > strings = file.find< char >("str0");
 
 	{ //read index chunk, add to meshes:
+		// (in indexed files, index entries give ranges of elements rather than of vertices)
 		struct IndexEntry {
 			uint32_t name_begin, name_end;
 			uint32_t vertex_begin, vertex_end;
 		};
 		static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
 
-		std::vector< IndexEntry > index;
-		read_chunk(file, "idx0", &index);
+		ChunkFile::Span< IndexEntry > index = file.find< IndexEntry >("idx0");
+
+		//quantized files also store each mesh's bounding box, which positions are relative to:
+		struct BoxEntry {
+			glm::vec3 min, max;
+		};
+		static_assert(sizeof(BoxEntry) == 24, "Box entry should be packed");
+
+		ChunkFile::Span< BoxEntry > boxes;
+		if (quantized) {
+			boxes = file.find< BoxEntry >("box0");
+			if (boxes.size() != index.size()) {
+				throw std::runtime_error("box chunk has a different number of entries than index chunk");
+			}
+		}
 
 		for (auto const &entry : index) {
 			if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
 				throw std::runtime_error("index entry has out-of-range name begin/end");
 			}
-			if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= total)) {
+			if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= (index_type == GL_NONE ? total : elements.size()))) {
 				throw std::runtime_error("index entry has out-of-range vertex start/count");
 			}
-			std::string name(&strings[0] + entry.name_begin, &strings[0] + entry.name_end);
+			std::string name(strings.data() + entry.name_begin, strings.data() + entry.name_end);
 			Mesh mesh;
 			mesh.type = GL_TRIANGLES;
 			mesh.start = entry.vertex_begin;
 			mesh.count = entry.vertex_end - entry.vertex_begin;
-			for (uint32_t v = entry.vertex_begin; v < entry.vertex_end; ++v) {
-				mesh.min = glm::min(mesh.min, data[v].Position);
-				mesh.max = glm::max(mesh.max, data[v].Position);
+			mesh.index_type = index_type;
+			if (quantized) {
+				BoxEntry const &box = boxes[&entry - index.data()];
+				mesh.min = box.min;
+				mesh.max = box.max;
+				mesh.position_scale = 0.5f * (box.max - box.min);
+				mesh.position_offset = 0.5f * (box.max + box.min);
+				mesh.octahedral_normals = true;
+			} else {
+				for (uint32_t i = entry.vertex_begin; i < entry.vertex_end; ++i) {
+					uint32_t v = (index_type == GL_NONE ? i : elements[i]);
+					mesh.min = glm::min(mesh.min, data[v].Position);
+					mesh.max = glm::max(mesh.max, data[v].Position);
+				}
 			}
-			bool inserted = meshes.insert(std::make_pair(name, mesh)).second;
+			bool inserted = prepared.meshes.insert(std::make_pair(name, mesh)).second;
 			if (!inserted) {
 				std::cerr << "WARNING: mesh name '" + name + "' in filename '" + filename + "' collides with existing mesh." << std::endl;
 			}
 		}
 	}
 
-	if (file.peek() != EOF) {
+	if (file.trailing_bytes) {
 		std::cerr << "WARNING: trailing data in mesh file '" << filename << "'" << std::endl;
 	}
 
 	/* //DEBUG:
 	std::cout << "File '" << filename << "' contained meshes";
-	for (auto const &m : meshes) {
-		if (&m.second == &meshes.rbegin()->second && meshes.size() > 1) std::cout << " and";
+	for (auto const &m : prepared.meshes) {
+		if (&m.second == &prepared.meshes.rbegin()->second && prepared.meshes.size() > 1) std::cout << " and";
 		std::cout << " '" << m.first << "'";
-		if (&m.second != &meshes.rbegin()->second) std::cout << ",";
+		if (&m.second != &prepared.meshes.rbegin()->second) std::cout << ",";
 	}
 	std::cout << std::endl;
 	*/
+
+	if (copy_data) {
+		//copy out everything the upload reads from the file, and unmap it:
+		bool copy_elements = (prepared.element_data && prepared.element_data != prepared.short_elements.data());
+		prepared.copied_data.resize(prepared.vertex_bytes + (copy_elements ? prepared.element_bytes : 0));
+		std::copy(prepared.vertex_data, prepared.vertex_data + prepared.vertex_bytes, prepared.copied_data.begin());
+		prepared.vertex_data = prepared.copied_data.data();
+		if (copy_elements) {
+			char const *element_data = reinterpret_cast< char const * >(prepared.element_data);
+			std::copy(element_data, element_data + prepared.element_bytes, prepared.copied_data.begin() + prepared.vertex_bytes);
+			prepared.element_data = prepared.copied_data.data() + prepared.vertex_bytes;
+		}
+		prepared.file.reset();
+	}
+
+	return ret;
+}
+
+MeshBuffer::MeshBuffer(std::string const &filename) : MeshBuffer(*prepare(filename)) {
+}
+
+MeshBuffer::MeshBuffer(Prepared const &prepared) {
+	TraceScope trace("MeshBuffer upload");
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, prepared.vertex_bytes, prepared.vertex_data, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (prepared.index_type != GL_NONE) {
+		glGenBuffers(1, &index_buffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, prepared.element_bytes, prepared.element_data, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+	load_note_upload(prepared.vertex_bytes + prepared.element_bytes);
+
+	Position = prepared.Position;
+	Normal = prepared.Normal;
+	Color = prepared.Color;
+	TexCoord = prepared.TexCoord;
+	meshes = prepared.meshes;
 }
 
 const Mesh &MeshBuffer::lookup(std::string const &name) const {
@@ -106,7 +252,7 @@ const Mesh &MeshBuffer::lookup(std::string const &name) const {
 	return f->second;
 }
 
-GLuint MeshBuffer::make_vao_for_program(GLuint program) const {
+GLuint MeshBuffer::make_vao_for_program(GLuint program, GLuint instance_buffer) const {
 	//create a new vertex array object:
 	GLuint vao = 0;
 	glGenVertexArrays(1, &vao);
@@ -128,6 +274,27 @@ GLuint MeshBuffer::make_vao_for_program(GLuint program) const {
 	bind_attribute("Color", Color);
 	bind_attribute("TexCoord", TexCoord);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	//The element buffer binding is part of the vao's state:
+	if (index_buffer != 0) {
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+	}
+
+	//Per-instance object-to-world matrix (a mat4x3 attribute takes up four consecutive vec3 locations):
+	if (instance_buffer != 0) {
+		GLint location = glGetAttribLocation(program, "OBJECT_TO_WORLD");
+		if (location != -1) {
+			glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+			for (GLuint column = 0; column < 4; ++column) {
+				glVertexAttribPointer(location + column, 3, GL_FLOAT, GL_FALSE, sizeof(glm::mat4x3), (GLbyte *)0 + column * sizeof(glm::vec3));
+				glVertexAttribDivisor(location + column, 1);
+				glEnableVertexAttribArray(location + column);
+				bound.insert(location + column);
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+	}
+
 	glBindVertexArray(0);
 
 	//Check that all active attributes were bound:
@@ -12,6 +12,7 @@
 #include "GL.hpp"
 #include <glm/glm.hpp>
 #include <map>
+#include <memory>
 #include <limits>
 #include <string>
 
@@ -20,31 +21,69 @@ struct Mesh {
 	//Meshes are vertex ranges (and primitive types) in their MeshBuffer:
 
 	GLenum type = GL_TRIANGLES; //type of primitives in mesh
-	GLuint start = 0; //index of first vertex
-	GLuint count = 0; //count of vertices
+	GLuint start = 0; //index of first vertex (or element, if indexed)
+	GLuint count = 0; //count of vertices (or elements, if indexed)
+
+	//Meshes from indexed files are ranges of the MeshBuffer's index_buffer, drawn with glDrawElements:
+	GLenum index_type = GL_NONE; //GL_NONE (not indexed), GL_UNSIGNED_SHORT, or GL_UNSIGNED_INT
 
 	//Bounding box.
 	//useful for debug visualization and (perhaps, eventually) collision detection:
 	glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
 	glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+
+	//Meshes from quantized files (see MeshBuffer::QuantizedVertex) need their vertices decoded in the vertex shader:
+	// object-space position = position_scale * Position + position_offset (maps [-1,1]^3 to the bounding box)
+	// normal = octahedral decoding of Normal.xy, if octahedral_normals is set
+	// (the defaults leave float vertices unchanged; copy these to the Scene pipeline of anything drawing the mesh)
+	glm::vec3 position_scale = glm::vec3(1.0f);
+	glm::vec3 position_offset = glm::vec3(0.0f);
+	bool octahedral_normals = false;
 };
 
+//GLSL for vertex shaders that draw meshes from a MeshBuffer (insert it right after the '#version' line):
+// declares uniforms POSITION_SCALE, POSITION_OFFSET, and OCTAHEDRAL_NORMALS (to be set from Mesh's members of the same names)
+// and functions decode_position(Position) and decode_normal(Normal), which undo quantization (and leave float vertices alone).
+extern char const *mesh_decode_glsl;
+
 struct MeshBuffer {
 	//construct from a file:
 	// note: will throw if file fails to read.
 	MeshBuffer(std::string const &filename);
 
+	//...which happens in two steps, so the slow one can run on a worker thread (see Load.hpp):
+	// prepare() reads and checks the file and computes bounds, without calling OpenGL (throws if file fails to read)
+	// constructing from the result uploads it (call on the OpenGL thread)
+	// if copy_data is set, the result doesn't keep the file mapped (so the file may change before the upload -- e.g., when hot reloading)
+	struct Prepared;
+	static std::shared_ptr< Prepared const > prepare(std::string const &filename, bool copy_data = false);
+	explicit MeshBuffer(Prepared const &prepared);
+
 	//look up a particular mesh by name:
 	// note: will throw if mesh not found.
 	const Mesh &lookup(std::string const &name) const;
 	
 	//build a vertex array object that links this vbo to attributes to a program:
 	// note: will throw if program defines attributes not contained in this buffer
-	GLuint make_vao_for_program(GLuint program) const;
+	// if instance_buffer is non-zero, also links the program's (mat4x3) "OBJECT_TO_WORLD" attribute
+	//  to per-instance matrices in instance_buffer (for use with Scene::InstancedDrawable)
+	GLuint make_vao_for_program(GLuint program, GLuint instance_buffer = 0) const;
 
 	//This is the OpenGL vertex buffer object containing the mesh data:
 	GLuint buffer = 0;
 
+	//...and, for indexed files, the element buffer (make_vao_for_program binds it to the vao):
+	GLuint index_buffer = 0;
+
+	//Vertex layout of quantized files, whose vertex chunk is 'qnct' instead of 'pnct' (20 bytes/vertex instead of 36):
+	struct QuantizedVertex {
+		glm::i16vec4 Position; //xyz: snorm16 within the mesh's bounding box; w: unused (zero)
+		glm::i16vec2 Normal; //snorm16 octahedral-encoded unit normal
+		glm::u8vec4 Color;
+		uint16_t TexCoord[2]; //half floats
+	};
+	static_assert(sizeof(QuantizedVertex) == 4*2+2*2+4*1+2*2, "QuantizedVertex is packed.");
+
 	//-- internals ---
 
 	//used by the lookup() function:
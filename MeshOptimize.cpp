@@ -0,0 +1,269 @@
+#include "MeshOptimize.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <unordered_set>
+
+std::vector< uint32_t > weld_vertices(void const *vertices, size_t count, size_t stride) {
+	char const *bytes = reinterpret_cast< char const * >(vertices);
+
+	//hash set of (indices of) unique vertices, compared by their bytes:
+	struct Hash {
+		char const *bytes;
+		size_t stride;
+		size_t operator()(uint32_t v) const {
+			//FNV-1a:
+			size_t hash = size_t(14695981039346656037ULL);
+			for (char const *b = bytes + v * stride, *end = b + stride; b != end; ++b) {
+				hash = (hash ^ size_t(uint8_t(*b))) * size_t(1099511628211ULL);
+			}
+			return hash;
+		}
+	};
+	struct Equal {
+		char const *bytes;
+		size_t stride;
+		bool operator()(uint32_t a, uint32_t b) const {
+			return std::memcmp(bytes + a * stride, bytes + b * stride, stride) == 0;
+		}
+	};
+	std::unordered_set< uint32_t, Hash, Equal > unique(count, Hash{bytes, stride}, Equal{bytes, stride});
+
+	//remap[first copy] gets the next unique index; later copies look up their first copy:
+	std::vector< uint32_t > remap(count);
+	uint32_t next = 0;
+	for (uint32_t v = 0; v < count; ++v) {
+		auto ret = unique.insert(v);
+		if (ret.second) {
+			remap[v] = next++;
+		} else {
+			remap[v] = remap[*ret.first];
+		}
+	}
+	return remap;
+}
+
+//-------------------------
+//Forsyth's algorithm: greedily emit the best-scoring triangle, where a triangle's score is the
+// sum of its vertices' scores, which favor vertices that are in the (simulated) LRU cache and
+// vertices with few remaining triangles (so that stragglers get finished off).
+// (see https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html)
+
+namespace {
+
+constexpr uint32_t CacheSize = 32;
+constexpr float CacheDecayPower = 1.5f;
+constexpr float LastTriangleScore = 0.75f;
+constexpr float ValenceBoostScale = 2.0f;
+constexpr float ValenceBoostPower = 0.5f;
+
+float vertex_score(int32_t cache_position, uint32_t remaining) {
+	if (remaining == 0) return -1.0f; //no triangles left to draw with this vertex
+
+	float score = 0.0f;
+	if (cache_position < 0) {
+		//not in cache
+	} else if (cache_position < 3) {
+		//used by the last triangle; a fixed score keeps the optimizer from favoring a particular winding:
+		score = LastTriangleScore;
+	} else {
+		assert(cache_position < int32_t(CacheSize));
+		float scale = 1.0f / float(CacheSize - 3);
+		score = std::pow(1.0f - float(cache_position - 3) * scale, CacheDecayPower);
+	}
+	//boost vertices with few triangles left:
+	score += ValenceBoostScale * std::pow(float(remaining), -ValenceBoostPower);
+	return score;
+}
+
+} //namespace
+
+void optimize_vertex_cache(uint32_t *indices, size_t index_count, size_t vertex_count) {
+	assert(index_count % 3 == 0);
+	size_t const triangle_count = index_count / 3;
+	if (triangle_count == 0) return;
+
+	//triangles using each vertex (as a CSR-style adjacency list):
+	std::vector< uint32_t > remaining(vertex_count, 0); //triangles not yet emitted that use vertex
+	for (size_t i = 0; i < index_count; ++i) {
+		assert(indices[i] < vertex_count);
+		remaining[indices[i]] += 1;
+	}
+	std::vector< uint32_t > first(vertex_count + 1, 0);
+	for (size_t v = 0; v < vertex_count; ++v) {
+		first[v + 1] = first[v] + remaining[v];
+	}
+	std::vector< uint32_t > adjacent(index_count);
+	{
+		std::vector< uint32_t > fill(first.begin(), first.end() - 1);
+		for (size_t i = 0; i < index_count; ++i) {
+			adjacent[fill[indices[i]]++] = uint32_t(i / 3);
+		}
+	}
+
+	std::vector< int32_t > cache_position(vertex_count, -1);
+	std::vector< float > score(vertex_count);
+	for (size_t v = 0; v < vertex_count; ++v) {
+		score[v] = vertex_score(-1, remaining[v]);
+	}
+
+	std::vector< float > triangle_score(triangle_count);
+	std::vector< bool > emitted(triangle_count, false);
+	for (size_t t = 0; t < triangle_count; ++t) {
+		triangle_score[t] = score[indices[3*t+0]] + score[indices[3*t+1]] + score[indices[3*t+2]];
+	}
+
+	std::vector< uint32_t > output;
+	output.reserve(index_count);
+
+	std::vector< uint32_t > cache; //most recent first; CacheSize + 3 entries while updating
+	cache.reserve(CacheSize + 3);
+
+	size_t scan = 0; //no triangle before 'scan' is un-emitted (for the fallback search)
+	uint32_t best = -1U;
+
+	//fallback: best-scoring triangle anywhere (only needed at the start and when the cache runs dry):
+	auto find_best = [&]() {
+		uint32_t ret = -1U;
+		while (scan < triangle_count && emitted[scan]) ++scan;
+		for (size_t t = scan; t < triangle_count; ++t) {
+			if (!emitted[t] && (ret == -1U || triangle_score[t] > triangle_score[ret])) ret = uint32_t(t);
+		}
+		return ret;
+	};
+
+	best = find_best();
+	while (best != -1U) {
+		//emit:
+		emitted[best] = true;
+		uint32_t const *tri = indices + 3 * best;
+		for (uint32_t c = 0; c < 3; ++c) {
+			output.emplace_back(tri[c]);
+			uint32_t v = tri[c];
+			//remove from vertex's list of remaining triangles:
+			uint32_t *begin = adjacent.data() + first[v];
+			uint32_t *end = begin + remaining[v];
+			uint32_t *at = std::find(begin, end, best);
+			assert(at != end);
+			std::swap(*at, *(end - 1));
+			remaining[v] -= 1;
+		}
+
+		//move the triangle's vertices to the front of the cache:
+		std::vector< uint32_t > next;
+		next.reserve(CacheSize + 3);
+		next.insert(next.end(), tri, tri + 3);
+		for (uint32_t v : cache) {
+			if (v != tri[0] && v != tri[1] && v != tri[2]) next.emplace_back(v);
+		}
+
+		//update scores of everything that was in the cache (including anything falling out of it):
+		best = -1U;
+		float best_score = -1.0f;
+		for (uint32_t i = 0; i < next.size(); ++i) {
+			uint32_t v = next[i];
+			cache_position[v] = (i < CacheSize ? int32_t(i) : -1);
+			float new_score = vertex_score(cache_position[v], remaining[v]);
+			float delta = new_score - score[v];
+			score[v] = new_score;
+			for (uint32_t a = first[v]; a < first[v] + remaining[v]; ++a) {
+				uint32_t t = adjacent[a];
+				triangle_score[t] += delta;
+				if (triangle_score[t] > best_score) {
+					best_score = triangle_score[t];
+					best = t;
+				}
+			}
+		}
+		if (next.size() > CacheSize) next.resize(CacheSize);
+		cache.swap(next);
+
+		//no triangles touch the cache? fall back to a global search:
+		if (best == -1U) best = find_best();
+	}
+
+	assert(output.size() == index_count);
+	std::copy(output.begin(), output.end(), indices);
+}
+
+std::vector< uint32_t > optimize_vertex_fetch(uint32_t *indices, size_t index_count, size_t vertex_count) {
+	std::vector< uint32_t > remap(vertex_count, -1U);
+	uint32_t next = 0;
+	for (size_t i = 0; i < index_count; ++i) {
+		assert(indices[i] < vertex_count);
+		uint32_t &to = remap[indices[i]];
+		if (to == -1U) to = next++;
+		indices[i] = to;
+	}
+	return remap;
+}
+
+float vertex_cache_acmr(uint32_t const *indices, size_t index_count, uint32_t cache_size) {
+	if (index_count < 3) return 0.0f;
+	std::deque< uint32_t > fifo;
+	uint32_t misses = 0;
+	for (size_t i = 0; i < index_count; ++i) {
+		if (std::find(fifo.begin(), fifo.end(), indices[i]) != fifo.end()) continue;
+		misses += 1;
+		fifo.emplace_back(indices[i]);
+		if (fifo.size() > cache_size) fifo.pop_front();
+	}
+	return float(misses) / float(index_count / 3);
+}
+
+//-------------------------
+
+int16_t quantize_snorm16(float x) {
+	x = std::max(-1.0f, std::min(1.0f, x)); //(also maps NaN to -1)
+	return int16_t(std::lround(x * 32767.0f));
+}
+
+uint16_t float_to_half(float x) {
+	uint32_t bits;
+	std::memcpy(&bits, &x, sizeof(bits));
+
+	uint16_t sign = uint16_t((bits >> 16) & 0x8000);
+	uint32_t exponent = (bits >> 23) & 0xff;
+	uint32_t mantissa = bits & 0x7fffff;
+
+	if (exponent == 0xff) { //infinity or NaN (keeping NaNs NaN):
+		return uint16_t(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+	}
+
+	int32_t e = int32_t(exponent) - 127 + 15; //re-biased exponent
+	if (e >= 0x1f) return uint16_t(sign | 0x7c00); //too large: infinity
+
+	if (e <= 0) { //subnormal half (or zero):
+		if (e < -10) return sign; //too small: (signed) zero
+		mantissa |= 0x800000; //make the implicit leading one explicit
+		uint32_t shift = uint32_t(14 - e);
+		uint32_t half = mantissa >> shift;
+		uint32_t rest = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (half & 1))) half += 1;
+		return uint16_t(sign | half);
+	}
+
+	uint32_t half = (uint32_t(e) << 10) | (mantissa >> 13);
+	uint32_t rest = mantissa & 0x1fff;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half += 1; //(a carry into the exponent is still correct)
+	return uint16_t(sign | half);
+}
+
+void encode_octahedral(float const n[3], float out[2]) {
+	float l1 = std::abs(n[0]) + std::abs(n[1]) + std::abs(n[2]);
+	float x = n[0] / l1;
+	float y = n[1] / l1;
+	if (n[2] < 0.0f) {
+		//fold the lower hemisphere over the diagonals:
+		float fx = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float fy = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = fx;
+		y = fy;
+	}
+	out[0] = x;
+	out[1] = y;
+}
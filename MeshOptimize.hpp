@@ -0,0 +1,55 @@
+#pragma once
+
+/*
+ * Helpers for turning triangle soup (as written by export-meshes.py) into
+ *  indexed triangle lists that are cheap for the GPU to draw:
+ *
+ *  - weld_vertices() merges byte-identical vertices, so each is stored and
+ *    shaded once instead of once per triangle that uses it.
+ *  - optimize_vertex_cache() reorders triangles (Tom Forsyth's "Linear-Speed
+ *    Vertex Cache Optimisation") so recently-transformed vertices get reused.
+ *  - optimize_vertex_fetch() renumbers vertices in order of first use, so
+ *    vertex data is read (mostly) front to back.
+ *
+ * There are also encoders for the quantized vertex format (index-meshes
+ *  --quantize; see MeshBuffer::QuantizedVertex), which need to match the
+ *  decoding in mesh_decode_glsl (Mesh.cpp):
+ *
+ *  - quantize_snorm16() / float_to_half() pack single values.
+ *  - encode_octahedral() maps a unit vector onto the [-1,1]^2 square by
+ *    projecting it onto an octahedron and unfolding the lower half.
+ *
+ * These are used offline by the index-meshes tool; MeshBuffer just loads the
+ *  result (see the "idx1" and "qnct" chunks in Mesh.cpp).
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//find identical vertices among 'count' vertices of 'stride' bytes each:
+// returns remap, where remap[i] is the index vertex i should have in an array of unique vertices
+// (unique vertices are numbered in order of first appearance, so remap[i] <= i)
+std::vector< uint32_t > weld_vertices(void const *vertices, size_t count, size_t stride);
+
+//reorder the triangles in 'indices' (a GL_TRIANGLES index list) to improve post-transform vertex cache hits:
+// vertex_count must be larger than every index
+void optimize_vertex_cache(uint32_t *indices, size_t index_count, size_t vertex_count);
+
+//renumber vertices in order of first use in 'indices' (rewriting 'indices' in place):
+// returns remap, where remap[old index] is the new index (or -1U for vertices 'indices' never uses)
+std::vector< uint32_t > optimize_vertex_fetch(uint32_t *indices, size_t index_count, size_t vertex_count);
+
+//average number of vertex shader invocations per triangle with a FIFO post-transform cache of 'cache_size' entries:
+// (3.0 for triangle soup; well-ordered indexed meshes get well under 1.0)
+float vertex_cache_acmr(uint32_t const *indices, size_t index_count, uint32_t cache_size = 16);
+
+//round x (clamped to [-1,1]) to a GL_SHORT normalized value (decoded as max(q / 32767, -1)):
+int16_t quantize_snorm16(float x);
+
+//convert to an IEEE half float (round-to-nearest-even; overflows become infinity):
+uint16_t float_to_half(float x);
+
+//octahedral encoding of non-zero vector n, in [-1,1]^2:
+void encode_octahedral(float const n[3], float out[2]);
@@ -0,0 +1,46 @@
+#pragma once
+
+/*
+ * Particles holds the state of many simple falling particles (e.g., snowflakes)
+ *  in structure-of-arrays form.
+ *
+ * Each attribute is stored in its own contiguous, 64-byte aligned array, so
+ *  that per-frame loops only stream through the attributes they touch.
+ *
+ * Particles are just indices; code that wants to draw them (e.g., through
+ *  Scene::Transforms) should copy positions out of these arrays at draw time.
+ *
+ */
+
+#include "aligned_vector.hpp"
+
+#include <glm/glm.hpp>
+
+struct Particles {
+	//per-particle position:
+	aligned_vector< float > x;
+	aligned_vector< float > y;
+	aligned_vector< float > z;
+
+	//per-particle fall speed (units per second, along -z):
+	aligned_vector< float > fall_speed;
+
+	size_t size() const { return z.size(); }
+
+	//change particle count (new particles are placed at the origin and don't fall):
+	void resize(size_t count) {
+		x.resize(count, 0.0f);
+		y.resize(count, 0.0f);
+		z.resize(count, 0.0f);
+		fall_speed.resize(count, 0.0f);
+	}
+
+	glm::vec3 position(size_t i) const {
+		return glm::vec3(x[i], y[i], z[i]);
+	}
+	void set_position(size_t i, glm::vec3 const &p) {
+		x[i] = p.x;
+		y[i] = p.y;
+		z[i] = p.z;
+	}
+};
@@ -5,28 +5,44 @@
 #include "DrawLines.hpp"
 #include "Mesh.hpp"
 #include "Load.hpp"
+#include "Trace.hpp"
 #include "gl_errors.hpp"
 #include "data_path.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 
-#include <random>
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
 
 GLuint snowglobe_meshes_for_texture = 0;
-Load< MeshBuffer > snowglobe_meshes(LoadTagDefault, []() -> MeshBuffer const * {
-	MeshBuffer const *ret = new MeshBuffer(data_path("snow-globe.pnct"));
-	snowglobe_meshes_for_texture = ret->make_vao_for_program(lit_color_texture_program->program);
-	return ret;
+//meshes are read on worker threads (see Load.hpp); only the upload happens on the OpenGL thread:
+// (the programs are LoadTagEarly, so they are loaded before these finish)
+Load< MeshBuffer > snowglobe_meshes(LoadTagDefault, {}, []() {
+	auto prepared = MeshBuffer::prepare(data_path("snow-globe.pnct"));
+	return [prepared]() -> MeshBuffer const * {
+		MeshBuffer const *ret = new MeshBuffer(*prepared);
+		snowglobe_meshes_for_texture = ret->make_vao_for_program(lit_color_texture_program->program);
+		return ret;
+	};
 });
 
-GLuint snow_texture = 0;
-Load< MeshBuffer > snow_meshes(LoadTagDefault, []() -> MeshBuffer const * {
-	MeshBuffer const *ret = new MeshBuffer(data_path("snow.pnct"));
-	snow_texture = ret->make_vao_for_program(lit_color_texture_program->program);
-	return ret;
+GLuint snow_instance_buffer = 0;
+GLuint snow_meshes_for_instanced = 0;
+Load< MeshBuffer > snow_meshes(LoadTagDefault, {}, []() {
+	auto prepared = MeshBuffer::prepare(data_path("snow.pnct"));
+	return [prepared]() -> MeshBuffer const * {
+		MeshBuffer const *ret = new MeshBuffer(*prepared);
+		//snow is drawn instanced, with per-flake matrices streamed through snow_instance_buffer:
+		glGenBuffers(1, &snow_instance_buffer);
+		snow_meshes_for_instanced = ret->make_vao_for_program(lit_color_texture_instanced_program->program, snow_instance_buffer);
+		return ret;
+	};
 });
 
-Load< Scene > snowglobe_scene(LoadTagDefault, []() -> Scene const * {
+//read the scene (with snowflakes) from its files, using the current mesh buffers:
+// (used to load the scene and to re-load it when the files change)
+static Scene make_snowglobe_scene() {
 	Scene s(data_path("snow-globe.scene"), [&](Scene &scene, Scene::Transform *transform, std::string const &mesh_name) {
 		Mesh const &mesh = snowglobe_meshes->lookup(mesh_name);
 
@@ -39,47 +55,64 @@ Load< Scene > snowglobe_scene(LoadTagDefault, []() -> Scene const * {
 		drawable.pipeline.type = mesh.type;
 		drawable.pipeline.start = mesh.start;
 		drawable.pipeline.count = mesh.count;
+		drawable.pipeline.index_type = mesh.index_type;
+		drawable.pipeline.min = mesh.min;
+		drawable.pipeline.max = mesh.max;
+		drawable.pipeline.position_scale = mesh.position_scale;
+		drawable.pipeline.position_offset = mesh.position_offset;
+		drawable.pipeline.octahedral_normals = mesh.octahedral_normals;
 
 	});
-	uint32_t copies = 200;
-	for (uint32_t i = 0; i < copies; i++) {
-		s.load(data_path("snow.scene"), [&](Scene &scene, Scene::Transform *transform, std::string const &mesh_name) {
+
+	//read snow.scene once, as a template for all of the snowflakes:
+	Scene const snow_template(data_path("snow.scene"), [&](Scene &scene, Scene::Transform *transform, std::string const &mesh_name) {
 		Mesh const &mesh = snow_meshes->lookup(mesh_name);
 
-		transform->name = "Snow" + std::to_string(i);
 		transform->position = {0.0f, 0.0f, -5.0f}; // hide below ground for now
 
-		scene.drawables.emplace_back(transform);
-		Scene::Drawable &drawable = scene.drawables.back();
+		scene.instanced_drawables.emplace_back(std::vector< Scene::Transform * >{ transform });
+		Scene::InstancedDrawable &drawable = scene.instanced_drawables.back();
 
-		drawable.pipeline = lit_color_texture_program_pipeline;
+		drawable.pipeline = lit_color_texture_instanced_program_pipeline;
 
-		drawable.pipeline.vao = snow_texture;
+		drawable.pipeline.vao = snow_meshes_for_instanced;
+		drawable.pipeline.instance_buffer = snow_instance_buffer;
 		drawable.pipeline.type = mesh.type;
 		drawable.pipeline.start = mesh.start;
 		drawable.pipeline.count = mesh.count;
-		});
-	}
-	return new Scene(s);
+		drawable.pipeline.index_type = mesh.index_type;
+		drawable.pipeline.min = mesh.min;
+		drawable.pipeline.max = mesh.max;
+		drawable.pipeline.position_scale = mesh.position_scale;
+		drawable.pipeline.position_offset = mesh.position_offset;
+		drawable.pipeline.octahedral_normals = mesh.octahedral_normals;
+	});
+
+	//...and stamp out copies named "Snow0", "Snow1", ... (all drawn by one instanced drawable per snow mesh):
+	uint32_t copies = 200;
+	s.instantiate(snow_template, copies);
+
+	return s;
+}
+
+//the scene is built on a worker thread too, once the meshes (and pipelines) it refers to are loaded:
+Load< Scene > snowglobe_scene(LoadTagDefault, {&snowglobe_meshes, &snow_meshes, &lit_color_texture_program, &lit_color_texture_instanced_program}, []() {
+	Scene const *ret = new Scene(make_snowglobe_scene());
+	return [ret]() -> Scene const * { return ret; };
 });
 
-void PlayMode::reset_snow_position(uint32_t i) {
-	Particle p = snow[i];
-	// generate random distance and angle
-	// sourced partly from https://en.cppreference.com/w/cpp/numeric/random/uniform_real_distribution
-	std::random_device rd;
-    std::mt19937 gen(rd());
-	// radius distribution is proportional to r
-	std::uniform_real_distribution<float> mag(0.0f, 1.0f);
-	float r = std::sqrtf(mag(gen)) * (bound_radius - globe_radius);
-    std::uniform_real_distribution<float> ang(0.0f, 2.0f * float(M_PI));
-	float angle = ang(gen);
-	std::uniform_real_distribution<float> alt(snow_height - snow_height_variation, snow_height + snow_height_variation);
-	p.transform->position = base_position;
-	p.transform->position += glm::vec3{r * std::cos(angle), r * std::sin(angle), alt(gen)};
-
-	std::uniform_real_distribution<float> v(snowfall_speed - snowfall_speed_variation, snowfall_speed + snowfall_speed_variation);
-	p.fall_speed = v(gen);
+//point the drawables of the template scene (which new PlayModes copy) at a reloaded mesh buffer:
+static void retarget_snowglobe_scene(MeshBuffer const &old_buffer, GLuint old_vao, MeshBuffer const &new_buffer, GLuint new_vao) {
+	Scene *retargeted = new Scene(*snowglobe_scene);
+	retarget_drawables(*retargeted, old_buffer, old_vao, new_buffer, new_vao);
+	delete snowglobe_scene.value;
+	snowglobe_scene.value = retargeted;
+}
+
+void PlayMode::update_snow_transforms(float alpha) {
+	for (uint32_t i = 0; i < world.snow.size(); ++i) {
+		snow_transforms[i]->position = glm::mix(snow_previous.position(i), world.snow.position(i), alpha);
+	}
 }
 
 PlayMode::PlayMode() : scene(*snowglobe_scene) {
@@ -88,33 +121,131 @@ PlayMode::PlayMode() : scene(*snowglobe_scene) {
 		if (transform.name == "Base") base = &transform;
 		if (transform.name == "Globe") globe = &transform;
 		if (transform.name.substr(0, 4) == "Snow" && transform.name != "Snow_test") {
-			Particle p;
-			p.transform = &transform;
-			p.id = std::stoul(&transform.name[4]);
-			snow.push_back(p);
+			uint32_t id = std::stoul(&transform.name[4]);
+			if (id >= snow_transforms.size()) snow_transforms.resize(id + 1, nullptr);
+			snow_transforms[id] = &transform;
 		}
 	}
 	if (base == nullptr) throw std::runtime_error("Base not found.");
 
 	base_rotation = base->rotation;
-	base_position = base->position;
-	globe_position = globe->position;
-
-	if (snow.size() < copies) throw std::runtime_error("Not enough snow.");
-
-	for (Particle p: snow) {
-		reset_snow_position(p.id);
-	}
 
 	//get pointer to camera for convenience:
 	if (scene.cameras.size() != 1) throw std::runtime_error("Expecting scene to have exactly one camera, but it has " + std::to_string(scene.cameras.size()));
 	camera = &scene.cameras.front();
+
+	//start the game where the scene has things:
+	SnowWorld::Config config;
+	config.base_position = base->position;
+	config.globe_offset = globe->position;
+	{ //the buttons move the base relative to the camera (but not up or down):
+		glm::mat4x3 frame = camera->transform->make_local_to_parent();
+		config.move_right = glm::vec3(frame[0].x, frame[0].y, 0.0f);
+		config.move_forward = glm::vec3(-frame[2].x, -frame[2].y, 0.0f);
+	}
+
+	if (snow_transforms.size() < config.copies) throw std::runtime_error("Not enough snow.");
+	snow_transforms.resize(config.copies);
+	for (auto t : snow_transforms) {
+		if (t == nullptr) throw std::runtime_error("Missing snow transform.");
+	}
+
+	world.rng = random_stream(0); //(so a run is reproducible from random_seed())
+	world.reset(config);
+
+	base_at_previous = world.base_at;
+	snow_previous = world.snow;
+	update_snow_transforms(1.0f);
+
+	//reload meshes and the scene when they are re-exported:
+	hot_reload.watch_meshes(data_path("snow-globe.pnct"), &snowglobe_meshes.value, [this](MeshBuffer const &old_buffer, MeshBuffer const &new_buffer) {
+		GLuint vao = new_buffer.make_vao_for_program(lit_color_texture_program->program);
+		retarget_drawables(scene, old_buffer, snowglobe_meshes_for_texture, new_buffer, vao);
+		retarget_snowglobe_scene(old_buffer, snowglobe_meshes_for_texture, new_buffer, vao);
+		glDeleteVertexArrays(1, &snowglobe_meshes_for_texture);
+		snowglobe_meshes_for_texture = vao;
+	});
+	hot_reload.watch_meshes(data_path("snow.pnct"), &snow_meshes.value, [this](MeshBuffer const &old_buffer, MeshBuffer const &new_buffer) {
+		GLuint vao = new_buffer.make_vao_for_program(lit_color_texture_instanced_program->program, snow_instance_buffer);
+		retarget_drawables(scene, old_buffer, snow_meshes_for_instanced, new_buffer, vao);
+		retarget_snowglobe_scene(old_buffer, snow_meshes_for_instanced, new_buffer, vao);
+		glDeleteVertexArrays(1, &snow_meshes_for_instanced);
+		snow_meshes_for_instanced = vao;
+	});
+	auto reload_scene = [this]() {
+		Scene fresh = make_snowglobe_scene();
+
+		//check for everything the game needs before touching the live scene:
+		uint32_t copies = world.config.copies;
+		std::vector< bool > have_snow(copies, false);
+		bool have_base = false, have_globe = false;
+		for (auto const &transform : fresh.transforms) {
+			if (transform.name == "Base") have_base = true;
+			if (transform.name == "Globe") have_globe = true;
+			if (transform.name.substr(0, 4) == "Snow" && transform.name != "Snow_test") {
+				uint32_t id = std::stoul(&transform.name[4]);
+				if (id < copies) have_snow[id] = true;
+			}
+		}
+		if (!have_base || !have_globe) throw std::runtime_error("Base or Globe not found.");
+		if (std::find(have_snow.begin(), have_snow.end(), false) != have_snow.end()) throw std::runtime_error("Missing snow transform.");
+		if (fresh.cameras.size() != 1) throw std::runtime_error("Expecting scene to have exactly one camera, but it has " + std::to_string(fresh.cameras.size()));
+
+		//keep the game's transforms where they are, and fix up pointers to them:
+		// (so Base, Globe, and the camera don't move, and world.config -- read from them in the constructor -- still
+		//  holds; the world deliberately isn't changed by a reload, so a session stays determined by its input)
+		std::unordered_map< Scene::Transform const *, Scene::Transform * > transform_map;
+		scene.reload(fresh, &transform_map);
+		base = transform_map.at(base);
+		globe = transform_map.at(globe);
+		for (auto &t : snow_transforms) {
+			t = transform_map.at(t);
+		}
+		camera = &scene.cameras.front();
+
+		delete snowglobe_scene.value;
+		snowglobe_scene.value = new Scene(fresh);
+	};
+	hot_reload.watch(data_path("snow-globe.scene"), reload_scene);
+	hot_reload.watch(data_path("snow.scene"), reload_scene);
 }
 
 PlayMode::~PlayMode() {
+	if (!record_filename.empty()) {
+		recording.header.seed = random_seed();
+		recording.header.tick = Tick;
+		recording.header.final_hash = world.state_hash();
+		try {
+			recording.save(record_filename);
+			std::cout << "Saved " << recording.ticks.size() << " ticks of input to '" << record_filename << "'." << std::endl;
+		} catch (std::exception &e) {
+			std::cerr << "WARNING: " << e.what() << std::endl;
+		}
+	}
+}
+
+void PlayMode::start_recording(std::string const &filename) {
+	record_filename = filename;
+	recording = InputRecording();
+	replaying = false;
+}
+
+void PlayMode::start_replay(InputRecording const &recording_) {
+	if (recording_.header.tick != Tick) {
+		throw std::runtime_error("Recording was made with " + std::to_string(recording_.header.tick) + "s ticks, but ticks are " + std::to_string(Tick) + "s.");
+	}
+	if (recording_.header.seed != random_seed()) {
+		throw std::runtime_error("Recording was made with seed " + std::to_string(recording_.header.seed) + ", but the seed is " + std::to_string(random_seed()) + ".");
+	}
+	record_filename.clear();
+	recording = recording_;
+	replaying = true;
+	replay_tick = 0;
 }
 
 bool PlayMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size) {
+	//buttons come from the recording during a replay:
+	if (replaying) return false;
 
 	if (evt.type == SDL_KEYDOWN) {
 		if (evt.key.keysym.sym == SDLK_a) {
@@ -154,62 +285,66 @@ bool PlayMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size)
 }
 
 void PlayMode::update(float elapsed) {
+	TraceScope trace("PlayMode::update");
+
+	//swap in any assets that changed on disk:
+	hot_reload.update();
 
-	if (!game_over) {
-		// slowly rotates through [0,1):
-		rotator += elapsed / 5.0f;
-		rotator -= std::floor(rotator);
+	//simulate all of the ticks that have elapsed:
+	// (main.cpp caps elapsed, so this is at most a handful)
+	tick_accumulator += elapsed;
+	while (tick_accumulator >= Tick) {
+		tick_accumulator -= Tick;
+		tick();
 	}
-	for (Particle p: snow) {
-		p.transform->position.z -= elapsed * p.fall_speed;
-		glm::vec3 cur_center = base->position + globe->position;
-		cur_center.z += globe_elevation;
-		if (!game_over) {
-			if (glm::length(p.transform->position - cur_center) <= globe_radius) {
-				points++;
-				reset_snow_position(p.id);
-			}
-			else if (p.transform->position.z < -1.0f) {
-				reset_snow_position(p.id);
-			}
+}
+
+void PlayMode::tick() {
+	//buttons in a recording (bits 0-3: held, bits 4-7: pressed during the tick):
+	Button *buttons[4] = {&left, &right, &down, &up};
+	if (replaying && replay_tick < recording.ticks.size()) {
+		uint8_t bits = recording.ticks[replay_tick++];
+		for (uint32_t b = 0; b < 4; ++b) {
+			buttons[b]->pressed = (bits >> b) & 1;
+			buttons[b]->downs = (bits >> (4 + b)) & 1;
 		}
+	} else if (!record_filename.empty()) {
+		uint8_t bits = 0;
+		for (uint32_t b = 0; b < 4; ++b) {
+			if (buttons[b]->pressed) bits |= uint8_t(1 << b);
+			if (buttons[b]->downs) bits |= uint8_t(1 << (4 + b));
+		}
+		recording.ticks.emplace_back(bits);
 	}
 
-	base->rotation = base_rotation * glm::angleAxis(
-		glm::radians(-360.0f * rotator),
-		glm::vec3(0.0f, 0.0f, 1.0f)
-	);
-
-	total_elapsed += elapsed;
-	game_over = total_elapsed > time_limit;
-
-	// move the globe:
-	{
+	//remember the current state to interpolate from:
+	rotator_previous = world.rotator;
+	base_at_previous = world.base_at;
+	std::copy(world.snow.x.begin(), world.snow.x.end(), snow_previous.x.begin());
+	std::copy(world.snow.y.begin(), world.snow.y.end(), snow_previous.y.begin());
+	std::copy(world.snow.z.begin(), world.snow.z.end(), snow_previous.z.begin());
 
-		//combine inputs into a move:
-		glm::vec2 move = glm::vec2(0.0f);
-		if (left.pressed && !right.pressed) move.x = -1.0f;
-		if (!left.pressed && right.pressed) move.x = 1.0f;
-		if (down.pressed && !up.pressed) move.y = -1.0f;
-		if (!down.pressed && up.pressed) move.y = 1.0f;
+	uint8_t held = 0;
+	for (uint32_t b = 0; b < 4; ++b) {
+		if (buttons[b]->pressed) held |= uint8_t(1 << b);
+	}
+	world.tick(Tick, held);
 
-		//make it so that moving diagonally doesn't go faster:
-		if (move != glm::vec2(0.0f)) move = glm::normalize(move) * base_speed * elapsed;
+	//don't interpolate flakes' jumps back up into the sky:
+	for (uint32_t i : world.snow_respawn) {
+		snow_previous.set_position(i, world.snow.position(i));
+	}
 
-		glm::mat4x3 frame = camera->transform->make_local_to_parent();
-		glm::vec3 frame_right = frame[0];
-		// glm::vec3 frame_up = frame[1];
-		glm::vec3 frame_forward = -frame[2];
-		
-		// remove z-coordinate to prevent height movement
-		frame_right.z = 0.0f;
-		frame_forward.z = 0.0f;
-
-		base->position += move.x * frame_right + move.y * frame_forward;
-		glm::vec3 diff = base->position - base_position;
-		// stay within the circle
-		if (glm::length(diff) >= bound_radius) {
-			base->position = base_position + bound_radius * glm::normalize(diff);
+	if (replaying && replay_tick == recording.ticks.size()) {
+		replaying = false;
+		for (Button *button : buttons) {
+			*button = Button();
+		}
+		uint32_t hash = world.state_hash();
+		if (hash == recording.header.final_hash) {
+			std::cout << "Replay of " << replay_tick << " ticks finished; state matches the recording." << std::endl;
+		} else {
+			std::cerr << "WARNING: replay of " << replay_tick << " ticks finished, but state hash " << hash << " doesn't match the recorded " << recording.header.final_hash << "." << std::endl;
 		}
 	}
 
@@ -224,14 +359,16 @@ void PlayMode::draw(glm::uvec2 const &drawable_size) {
 	//update camera aspect ratio for drawable:
 	camera->aspect = float(drawable_size.x) / float(drawable_size.y);
 
-	//set up light type and position for lit_color_texture_program:
-	glUseProgram(lit_color_texture_program->program);
-	glUniform1i(lit_color_texture_program->LIGHT_TYPE_int, 1);
-	glUniform3fv(lit_color_texture_program->LIGHT_DIRECTION_vec3, 1, glm::value_ptr(glm::vec3(-0.6f, 0.0f,-0.8f)));
-	glUniform3fv(lit_color_texture_program->LIGHT_ENERGY_vec3, 1, glm::value_ptr(glm::vec3(1.0f, 1.0f, 0.95f)));
+	//set up light type and position for lit_color_texture_program (and its instanced variant):
+	for (LitColorTextureProgram const *program : {lit_color_texture_program.value, lit_color_texture_instanced_program.value}) {
+		glUseProgram(program->program);
+		glUniform1i(program->LIGHT_TYPE_int, 1);
+		glUniform3fv(program->LIGHT_DIRECTION_vec3, 1, glm::value_ptr(glm::vec3(-0.6f, 0.0f,-0.8f)));
+		glUniform3fv(program->LIGHT_ENERGY_vec3, 1, glm::value_ptr(glm::vec3(1.0f, 1.0f, 0.95f)));
+	}
 	glUseProgram(0);
 
-	float time_dark = std::max(0.2f, 0.2f + 0.8f * (1.0f - total_elapsed / time_limit));
+	float time_dark = std::max(0.2f, 0.2f + 0.8f * (1.0f - world.total_elapsed / world.config.time_limit));
 	glClearColor(time_dark * 0.5f, time_dark * 0.7f, time_dark * 0.8f, 1.0f);
 	glClearDepth(1.0f); //1.0 is actually the default value to clear the depth buffer to, but FYI you can change it.
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -243,6 +380,17 @@ void PlayMode::draw(glm::uvec2 const &drawable_size) {
 
 	GL_ERRORS(); //print any errors produced by this setup code
 
+	{ //place everything part way from the previous tick to the latest one:
+		float alpha = tick_accumulator / Tick;
+		float spin = world.rotator;
+		if (spin < rotator_previous) spin += 1.0f; //(rotator wrapped around)
+		base->rotation = base_rotation * glm::angleAxis(
+			glm::radians(-360.0f * glm::mix(rotator_previous, spin, alpha)),
+			glm::vec3(0.0f, 0.0f, 1.0f)
+		);
+		base->position = glm::mix(base_at_previous, world.base_at, alpha);
+		update_snow_transforms(alpha);
+	}
 	scene.draw(*camera);
 
 	// glDisable(GL_BLEND);
@@ -259,14 +407,14 @@ void PlayMode::draw(glm::uvec2 const &drawable_size) {
 
 		constexpr float H = 0.09f;
 		std::string info;
-		if (game_over) {
+		if (world.game_over) {
 			info = "Game over!"
-				" | Snow collected: " + std::to_string(points);
+				" | Snow collected: " + std::to_string(world.points);
 		}
 		else {
-			int time_left = std::max(0, (int)(std::ceilf(time_limit - total_elapsed)));
+			int time_left = std::max(0, (int)(std::ceil(world.config.time_limit - world.total_elapsed)));
 			info = "WASD to move snow globe"
-				" | Snow collected: " + std::to_string(points) +
+				" | Snow collected: " + std::to_string(world.points) +
 				" | Time left: " + std::to_string(time_left) + " s";
 		}
 		lines.draw_text(info,
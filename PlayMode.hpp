@@ -1,6 +1,9 @@
 #include "Mode.hpp"
 
 #include "Scene.hpp"
+#include "HotReload.hpp"
+#include "SnowWorld.hpp"
+#include "InputRecording.hpp"
 
 #include <glm/glm.hpp>
 
@@ -9,7 +12,7 @@
 
 struct PlayMode : Mode {
 	PlayMode();
-	virtual ~PlayMode();
+	virtual ~PlayMode(); //(saves the recording, if recording)
 
 	//functions called by main loop:
 	virtual bool handle_event(SDL_Event const &, glm::uvec2 const &window_size) override;
@@ -24,41 +27,44 @@ struct PlayMode : Mode {
 		uint8_t pressed = 0;
 	} left, right, down, up;
 
+	//----- fixed-step simulation -----
+	//the game itself (see SnowWorld.hpp); this mode draws it and feeds it input:
+	SnowWorld world;
+
+	//the world advances in ticks of exactly Tick seconds, so a session is determined by its seed and
+	// the buttons held during each tick; update() runs as many ticks as have elapsed, and draw()
+	// interpolates between the last two.
+	static constexpr float Tick = 1.0f / 60.0f;
+	float tick_accumulator = 0.0f; //time not yet simulated (less than one Tick after update())
+	void tick(); //advance the game by one Tick
+
+	//world state as of the previous tick (for interpolation):
+	float rotator_previous = 0.0f;
+	glm::vec3 base_at_previous;
+	Particles snow_previous; //(only positions are used)
+
+	//record or replay the buttons of every tick (see InputRecording.hpp):
+	void start_recording(std::string const &filename); //saved to filename when this mode ends
+	void start_replay(InputRecording const &recording); //(the process-wide seed should already be recording.header.seed)
+	std::string record_filename; //(non-empty => recording)
+	InputRecording recording; //ticks recorded, or being replayed
+	bool replaying = false;
+	uint32_t replay_tick = 0; //next tick of the recording to replay
+
 	//local copy of the game scene (so code can change it during gameplay):
 	Scene scene;
 
-	float rotator = 0.0f;
-	float total_elapsed = 0.0f;
-	float time_limit = 60.0f;
-	uint32_t points = 0;
+	//reloads meshes and the scene (keeping the game's state) when their files change:
+	HotReload hot_reload;
 
 	//base rotation:
 	Scene::Transform *base = nullptr;
 	Scene::Transform *globe = nullptr;
 	glm::quat base_rotation;
-	glm::vec3 base_position;
-	glm::vec3 globe_position;
-	float base_speed = 40.0f;
-	float bound_radius = 45.0f;
-	float globe_elevation = 4.2f;
-	float globe_radius = 5.6f;
 
 	// snow
-	struct Particle {
-		Scene::Transform *transform = nullptr;
-		float fall_speed = 10.0f;
-		uint32_t id;
-	};
-	std::vector<Particle> snow;
-	float snow_height = 80.0f;
-	float snow_height_variation = 30.0f;
-	float snowfall_speed = 10.0f;
-	float snowfall_speed_variation = 3.0f;
-	uint32_t copies = 200;
-
-	void reset_snow_position(uint32_t i); // reset position of snow particle i
-
-	bool game_over = false;
+	std::vector< Scene::Transform * > snow_transforms; //flake i is drawn with snow_transforms[i]
+	void update_snow_transforms(float alpha); // copy flake positions (interpolated from the previous tick by alpha) into snow_transforms
 	
 	//camera:
 	Scene::Camera *camera = nullptr;
@@ -0,0 +1,68 @@
+#include "Random.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <random>
+
+Rng::Rng(uint64_t seed, uint64_t stream) {
+	//standard PCG32 seeding procedure:
+	state = 0;
+	increment = (stream << 1u) | 1u;
+	next();
+	state += seed;
+	next();
+}
+
+void Rng::fill_uniform(float lo, float hi, size_t count, float *out) {
+	float const scale = (hi - lo) * (1.0f / 16777216.0f);
+	for (size_t i = 0; i < count; ++i) {
+		out[i] = lo + float(next() >> 8) * scale;
+	}
+}
+
+void Rng::fill_disc(float radius, size_t count, float *x, float *y) {
+	float const two_pi = 2.0f * 3.14159265358979f;
+	for (size_t i = 0; i < count; ++i) {
+		float r = radius * std::sqrt(uniform01());
+		float angle = two_pi * uniform01();
+		x[i] = r * std::cos(angle);
+		y[i] = r * std::sin(angle);
+	}
+}
+
+//-------------------------
+
+namespace {
+	std::mutex seed_mutex;
+	bool seed_set = false;
+	uint64_t seed = 0;
+
+	std::atomic< uint64_t > next_thread_stream(0);
+}
+
+uint64_t random_seed() {
+	std::lock_guard< std::mutex > lock(seed_mutex);
+	if (!seed_set) {
+		std::random_device rd;
+		seed = (uint64_t(rd()) << 32) | uint64_t(rd());
+		seed_set = true;
+	}
+	return seed;
+}
+
+void set_random_seed(uint64_t seed_) {
+	std::lock_guard< std::mutex > lock(seed_mutex);
+	seed = seed_;
+	seed_set = true;
+}
+
+Rng random_stream(uint64_t stream) {
+	return Rng(random_seed(), stream);
+}
+
+Rng &thread_rng() {
+	//thread streams start at 2^32 so they don't collide with small explicit stream numbers:
+	thread_local Rng rng = random_stream((uint64_t(1) << 32) + next_thread_stream.fetch_add(1));
+	return rng;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+/*
+ * Small, fast, seedable random number generation.
+ *
+ * "Rng" is a PCG32 generator (see https://www.pcg-random.org/): 16 bytes of
+ *  state, a handful of instructions per number, and support for many
+ *  independent streams from the same seed.
+ *
+ * Everything is derived from one process-wide seed (see random_seed()), so
+ *  a run can be reproduced by passing the same seed again.
+ *
+ * //typical use:
+ * Rng rng = random_stream(0); //stream 0 of the process-wide seed
+ * float t = rng.uniform(0.0f, 1.0f);
+ *
+ * //...or, many at once:
+ * std::vector< float > ts(100);
+ * rng.fill_uniform(0.0f, 1.0f, ts.size(), ts.data());
+ *
+ */
+
+#include <cstdint>
+#include <cstddef>
+
+struct Rng {
+	//distinct (seed, stream) pairs produce independent sequences:
+	explicit Rng(uint64_t seed = 0, uint64_t stream = 0);
+
+	//next 32 random bits:
+	uint32_t next() {
+		uint64_t old = state;
+		state = old * 6364136223846793005ULL + increment;
+		uint32_t xorshifted = uint32_t(((old >> 18u) ^ old) >> 27u);
+		uint32_t rot = uint32_t(old >> 59u);
+		return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+	}
+
+	//uniform float in [0,1):
+	float uniform01() {
+		//top 24 bits fit exactly in a float's mantissa:
+		return float(next() >> 8) * (1.0f / 16777216.0f);
+	}
+
+	//uniform float in [lo,hi):
+	float uniform(float lo, float hi) {
+		return lo + (hi - lo) * uniform01();
+	}
+
+	//batch generators:
+	// out[i] uniform in [lo,hi):
+	void fill_uniform(float lo, float hi, size_t count, float *out);
+	// (x[i],y[i]) uniform over the disc of radius 'radius' centered at the origin:
+	// (uses the sqrt-of-uniform radius so points don't bunch up in the middle)
+	void fill_disc(float radius, size_t count, float *x, float *y);
+
+	uint64_t state = 0;
+	uint64_t increment = 1; //must be odd
+};
+
+//The process-wide seed:
+// if set_random_seed() hasn't been called, a seed is drawn from std::random_device on first use.
+uint64_t random_seed();
+void set_random_seed(uint64_t seed);
+
+//stream 'stream' of the process-wide seed:
+Rng random_stream(uint64_t stream);
+
+//per-thread generator:
+// each thread gets its own stream of the process-wide seed, numbered in the order that threads first call this function.
+// (code that needs to be reproducible across threads should use random_stream() with an explicit stream number.)
+Rng &thread_rng();
@@ -0,0 +1,50 @@
+#include "RenderQueue.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+uint64_t RenderQueue::make_key(uint32_t program, uint32_t vao, uint32_t textures, float depth) {
+	constexpr uint32_t IdMax = (1U << IdBits) - 1;
+	program = std::min(program, IdMax);
+	vao = std::min(vao, IdMax);
+	textures = std::min(textures, IdMax);
+
+	//bit patterns of non-negative floats sort the same way as their values,
+	// so the top DepthBits (after the always-zero sign bit) make a fine depth key:
+	uint32_t depth_bits = 0;
+	if (depth > 0.0f) { //(also false for NaN)
+		std::memcpy(&depth_bits, &depth, sizeof(depth_bits));
+		depth_bits >>= (31 - DepthBits);
+	}
+
+	return (uint64_t(program) << (2 * IdBits + DepthBits))
+	     | (uint64_t(vao) << (IdBits + DepthBits))
+	     | (uint64_t(textures) << DepthBits)
+	     | uint64_t(depth_bits);
+}
+
+void RenderQueue::sort() {
+	//LSD radix sort, one byte at a time:
+	scratch.resize(entries.size());
+	for (uint32_t shift = 0; shift < 64; shift += 8) {
+		uint32_t counts[256] = {};
+		for (Entry const &e : entries) {
+			counts[(e.key >> shift) & 0xff] += 1;
+		}
+		//skip passes where every key has the same byte (e.g., unused high id bits):
+		if (counts[(entries.empty() ? 0 : (entries[0].key >> shift) & 0xff)] == entries.size()) continue;
+
+		uint32_t offset = 0;
+		for (uint32_t &c : counts) {
+			uint32_t count = c;
+			c = offset;
+			offset += count;
+		}
+		for (Entry const &e : entries) {
+			scratch[counts[(e.key >> shift) & 0xff]++] = e;
+		}
+		entries.swap(scratch);
+	}
+	assert(std::is_sorted(entries.begin(), entries.end(), [](Entry const &a, Entry const &b) { return a.key < b.key; }));
+}
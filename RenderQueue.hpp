@@ -0,0 +1,74 @@
+#pragma once
+
+/*
+ * A RenderQueue orders draws so that ones sharing GL state end up next to
+ *  each other, which lets the submitting code skip redundant glUseProgram /
+ *  glBindVertexArray / glBindTexture calls.
+ *
+ * Each entry is a 64-bit sort key plus a 32-bit index into whatever list of
+ *  draws the caller keeps; sort() is a stable LSD radix sort on the keys.
+ *
+ * Keys only decide *order* -- the submitting code should still compare the
+ *  actual GL state before eliding a call, so two draws that happen to share
+ *  a key (e.g., because ids ran out of bits) are still drawn correctly.
+ *
+ * //typical use (see Scene::draw):
+ * queue.clear();
+ * for (...) queue.push(RenderQueue::make_key(program_id, vao_id, textures_id, depth), index);
+ * queue.sort();
+ * for (auto const &entry : queue.entries) { ... draw item entry.item ... }
+ *
+ */
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+struct RenderQueue {
+	struct Entry {
+		uint64_t key;
+		uint32_t item;
+	};
+	std::vector< Entry > entries;
+
+	void clear() { entries.clear(); }
+	void push(uint64_t key, uint32_t item) { entries.emplace_back(Entry{key, item}); }
+
+	//sort entries by key (stable, so equal keys stay in push order):
+	void sort();
+
+	//key layout, most significant bits first:
+	// [ program : 12 | vao : 12 | textures : 12 | depth : 28 ]
+	// program, vao, and textures are small per-frame ids (see Ids below); larger ids share the last bucket.
+	// depth is view distance; draws with equal state are ordered front-to-back (depths <= 0 all sort first).
+	enum : uint32_t { IdBits = 12, DepthBits = 28 };
+	static uint64_t make_key(uint32_t program, uint32_t vao, uint32_t textures, float depth);
+
+	//Ids hands out small, dense ids for (possibly large) values, in first-seen order:
+	// (used to squeeze GL object names and texture sets into the key)
+	template< typename K, typename Hash = std::hash< K > >
+	struct Ids;
+
+	//How much work submission did vs. what drawing each item in isolation would have done:
+	// ("state changes" are glUseProgram, glBindVertexArray, and glBindTexture calls)
+	struct Stats {
+		uint32_t draws = 0;
+		uint32_t program_changes = 0;
+		uint32_t vao_changes = 0;
+		uint32_t texture_changes = 0;
+		uint32_t state_changes_saved = 0;
+		uint32_t state_changes() const { return program_changes + vao_changes + texture_changes; }
+	};
+
+	std::vector< Entry > scratch; //(used by sort())
+};
+
+template< typename K, typename Hash >
+struct RenderQueue::Ids {
+	std::unordered_map< K, uint32_t, Hash > ids;
+	void clear() { ids.clear(); }
+	uint32_t operator()(K const &value) {
+		return ids.emplace(value, uint32_t(ids.size())).first->second;
+	}
+};
@@ -1,11 +1,15 @@
 #include "Scene.hpp"
 
 #include "gl_errors.hpp"
-#include "read_write_chunk.hpp"
+#include "ChunkFile.hpp"
+#include "Load.hpp"
+#include "FrameProfiler.hpp"
+#include "Trace.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 
-#include <fstream>
+#include <algorithm>
+#include <array>
 
 //-------------------------
 
@@ -71,6 +75,65 @@ glm::mat4x3 Scene::Transform::make_world_to_local() const {
 	}
 }
 
+glm::mat4x3 const &Scene::Transform::cached_local_to_world() const {
+	assert(cache.generation != 0 && "cached_local_to_world() used before Scene::update_world_matrices()");
+	return cache.local_to_world;
+}
+
+glm::mat4x3 const &Scene::Transform::cached_world_to_local() const {
+	assert(cache.generation != 0 && "cached_world_to_local() used before Scene::update_world_matrices()");
+	if (cache.world_to_local_generation != cache.generation) {
+		//parent's cache was brought up to date in the same pass as this transform's, so it can be used directly:
+		if (!parent) {
+			cache.world_to_local = make_parent_to_local();
+		} else {
+			cache.world_to_local = make_parent_to_local() * glm::mat4(parent->cached_world_to_local()); //note: glm::mat4(glm::mat4x3) pads with a (0,0,0,1) row
+		}
+		cache.world_to_local_generation = cache.generation;
+	}
+	return cache.world_to_local;
+}
+
+//-------------------------
+
+//brings a single transform's cached local_to_world up to date (after its parent's):
+static void update_world_matrix(Scene::Transform const &t, uint32_t pass) {
+	Scene::Transform::Cache &cache = t.cache;
+	if (cache.pass == pass) return;
+	cache.pass = pass;
+
+	//transforms are usually in topological order, so this almost never needs to recurse:
+	if (t.parent) update_world_matrix(*t.parent, pass);
+
+	bool dirty = cache.generation == 0
+	          || cache.position != t.position
+	          || cache.rotation != t.rotation
+	          || cache.scale != t.scale
+	          || cache.parent != t.parent
+	          || (t.parent && cache.parent_generation != t.parent->cache.generation);
+	if (!dirty) return;
+
+	if (!t.parent) {
+		cache.local_to_world = t.make_local_to_parent();
+	} else {
+		cache.local_to_world = t.parent->cache.local_to_world * glm::mat4(t.make_local_to_parent()); //note: glm::mat4(glm::mat4x3) pads with a (0,0,0,1) row
+	}
+	cache.position = t.position;
+	cache.rotation = t.rotation;
+	cache.scale = t.scale;
+	cache.parent = t.parent;
+	cache.parent_generation = (t.parent ? t.parent->cache.generation : 0);
+	cache.generation += 1;
+	if (cache.generation == 0) cache.generation = 1; //(skip 'never computed' on wrap-around)
+}
+
+void Scene::update_world_matrices() const {
+	update_pass += 1;
+	for (auto const &t : transforms) {
+		update_world_matrix(t, update_pass);
+	}
+}
+
 //-------------------------
 
 glm::mat4 Scene::Camera::make_projection() const {
@@ -82,14 +145,143 @@ glm::mat4 Scene::Camera::make_projection() const {
 
 void Scene::draw(Camera const &camera) const {
 	assert(camera.transform);
+	//n.b. not using the cached matrix, since the camera might not be part of this scene:
 	glm::mat4 world_to_clip = camera.make_projection() * glm::mat4(camera.transform->make_world_to_local());
 	glm::mat4x3 world_to_light = glm::mat4x3(1.0f);
 	draw(world_to_clip, world_to_light);
 }
 
-void Scene::draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_light) const {
+//texture bindings of a pipeline, as a hashable value (so RenderQueue::Ids can give each distinct set an id):
+typedef std::array< GLuint, 2 * Scene::Drawable::Pipeline::TextureCount > TextureSet;
+struct TextureSetHash {
+	size_t operator()(TextureSet const &set) const {
+		size_t hash = 0;
+		for (GLuint v : set) hash = hash * 31 + v;
+		return hash;
+	}
+};
+static TextureSet texture_set(Scene::Drawable::Pipeline::TextureInfo const *textures) {
+	TextureSet set;
+	for (uint32_t i = 0; i < Scene::Drawable::Pipeline::TextureCount; ++i) {
+		set[2 * i + 0] = textures[i].texture;
+		set[2 * i + 1] = (textures[i].texture != 0 ? textures[i].target : 0);
+	}
+	return set;
+}
+
+//byte offset (as glDrawElements wants it) of element 'start' in an element buffer:
+static void const *element_offset(GLenum index_type, GLuint start) {
+	assert(index_type == GL_UNSIGNED_SHORT || index_type == GL_UNSIGNED_INT);
+	return (GLbyte *)0 + size_t(start) * (index_type == GL_UNSIGNED_SHORT ? 2 : 4);
+}
+
+//set uniforms that decode quantized vertices (for pipelines whose programs have them):
+template< typename Pipeline >
+static void set_decode_uniforms(Pipeline const &pipeline) {
+	if (pipeline.POSITION_SCALE_vec3 != -1U) {
+		glUniform3fv(pipeline.POSITION_SCALE_vec3, 1, glm::value_ptr(pipeline.position_scale));
+	}
+	if (pipeline.POSITION_OFFSET_vec3 != -1U) {
+		glUniform3fv(pipeline.POSITION_OFFSET_vec3, 1, glm::value_ptr(pipeline.position_offset));
+	}
+	if (pipeline.OCTAHEDRAL_NORMALS_bool != -1U) {
+		glUniform1i(pipeline.OCTAHEDRAL_NORMALS_bool, pipeline.octahedral_normals ? 1 : 0);
+	}
+}
+
+//is [min,max] a real (non-empty) bounding box?
+static bool has_bounds(glm::vec3 const &min, glm::vec3 const &max) {
+	return min.x <= max.x && min.y <= max.y && min.z <= max.z;
+}
+
+//tracks GL state during Scene::draw so that redundant state changes can be skipped:
+struct DrawState {
+	DrawState(RenderQueue::Stats &stats_) : stats(stats_) { }
+	RenderQueue::Stats &stats;
+
+	GLuint program = -1U; //(-1U => unknown, so the first use_program() always calls glUseProgram)
+	GLuint vao = -1U;
+	Scene::Drawable::Pipeline::TextureInfo bound[Scene::Drawable::Pipeline::TextureCount]; //(all unbound to start with)
+	uint32_t active_texture = 0;
+
+	void use_program(GLuint program_) {
+		if (program_ == program) return;
+		glUseProgram(program_);
+		program = program_;
+		stats.program_changes += 1;
+	}
+
+	void bind_vao(GLuint vao_) {
+		if (vao_ == vao) return;
+		glBindVertexArray(vao_);
+		vao = vao_;
+		stats.vao_changes += 1;
+	}
+
+	//make the bound textures match 'textures' (texture == 0 means the unit should be unbound):
+	void bind_textures(Scene::Drawable::Pipeline::TextureInfo const *textures) {
+		for (uint32_t i = 0; i < Scene::Drawable::Pipeline::TextureCount; ++i) {
+			Scene::Drawable::Pipeline::TextureInfo const &want = textures[i];
+			Scene::Drawable::Pipeline::TextureInfo &have = bound[i];
+			if (want.texture == have.texture && (want.texture == 0 || want.target == have.target)) continue;
 
-	//Iterate through all drawables, sending each one to OpenGL:
+			if (active_texture != i) {
+				glActiveTexture(GL_TEXTURE0 + i);
+				active_texture = i;
+			}
+			if (have.texture != 0 && (want.texture == 0 || want.target != have.target)) {
+				glBindTexture(have.target, 0);
+				stats.texture_changes += 1;
+			}
+			if (want.texture != 0) {
+				glBindTexture(want.target, want.texture);
+				stats.texture_changes += 1;
+			}
+			have = want;
+		}
+	}
+
+	//un-bind everything (leaving texture unit 0 active):
+	void reset() {
+		Scene::Drawable::Pipeline::TextureInfo none[Scene::Drawable::Pipeline::TextureCount];
+		bind_textures(none);
+		if (active_texture != 0) {
+			glActiveTexture(GL_TEXTURE0);
+			active_texture = 0;
+		}
+		glUseProgram(0);
+		glBindVertexArray(0);
+	}
+
+	//what drawing with 'textures' cost before draws were sorted (use + bind program and vao, bind + un-bind each texture):
+	void count_unsorted(Scene::Drawable::Pipeline::TextureInfo const *textures) {
+		uint32_t unsorted = 2;
+		for (uint32_t i = 0; i < Scene::Drawable::Pipeline::TextureCount; ++i) {
+			if (textures[i].texture != 0) unsorted += 2;
+		}
+		stats.draws += 1;
+		unsorted_changes += unsorted;
+	}
+	uint32_t unsorted_changes = 0;
+};
+
+void Scene::draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_light) const {
+	TraceScope trace("Scene::draw");
+	FrameProfiler::GpuScope profile(FrameProfiler::GpuScene); //(GPU time shows in the frame time overlay)
+
+	//Make sure cached world matrices are current:
+	update_world_matrices();
+
+	//Cull drawables whose bounding spheres are outside the view frustum:
+	Frustum frustum(world_to_clip);
+	CullBatch &batch = cull_batch;
+	batch.clear();
+	cull_stats = CullStats();
+
+	std::vector< Drawable const * > &candidates = cull_candidates;
+	std::vector< uint32_t > &candidate_spheres = cull_candidate_spheres; //index in batch, or -1U if the drawable has no bounds
+	candidates.clear();
+	candidate_spheres.clear();
 	for (auto const &drawable : drawables) {
 		//Reference to drawable's pipeline for convenience:
 		Scene::Drawable::Pipeline const &pipeline = drawable.pipeline;
@@ -101,78 +293,195 @@ void Scene::draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_lig
 		//skip any drawables that don't contain any vertices:
 		if (pipeline.count == 0) continue;
 
+		assert(drawable.transform); //drawables *must* have a transform
+		candidates.emplace_back(&drawable);
+		if (has_bounds(pipeline.min, pipeline.max)) {
+			candidate_spheres.emplace_back(batch.add(Frustum::bounding_sphere(drawable.transform->cached_local_to_world(), pipeline.min, pipeline.max)));
+		} else {
+			candidate_spheres.emplace_back(-1U);
+		}
+	}
+	batch.cull(frustum, cull_stats);
 
-		//Set shader program:
-		glUseProgram(pipeline.program);
+	//Queue up everything drawable, keyed by GL state (and, within the same state, front-to-back):
+	// (items [0, queued_drawables.size()) are drawables; the rest are instanced drawables)
+	std::vector< Drawable const * > queued_drawables;
+	std::vector< InstancedDrawable const * > queued_instanced;
+	RenderQueue::Ids< GLuint > program_ids;
+	RenderQueue::Ids< GLuint > vao_ids;
+	RenderQueue::Ids< TextureSet, TextureSetHash > texture_ids;
 
-		//Set attribute sources:
-		glBindVertexArray(pipeline.vao);
+	render_queue.clear();
+	for (uint32_t c = 0; c < candidates.size(); ++c) {
+		if (candidate_spheres[c] != -1U && !batch.is_visible(candidate_spheres[c])) continue;
 
-		//Configure program uniforms:
+		Drawable const &drawable = *candidates[c];
+		Scene::Drawable::Pipeline const &pipeline = drawable.pipeline;
 
-		//the object-to-world matrix is used in all three of these uniforms:
-		assert(drawable.transform); //drawables *must* have a transform
-		glm::mat4x3 object_to_world = drawable.transform->make_local_to_world();
+		glm::vec3 const &position = drawable.transform->cached_local_to_world()[3];
+		float depth = (world_to_clip * glm::vec4(position, 1.0f)).w; //(distance along view direction, for a perspective projection)
 
-		//OBJECT_TO_CLIP takes vertices from object space to clip space:
-		if (pipeline.OBJECT_TO_CLIP_mat4 != -1U) {
-			glm::mat4 object_to_clip = world_to_clip * glm::mat4(object_to_world);
-			glUniformMatrix4fv(pipeline.OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(object_to_clip));
-		}
+		render_queue.push(RenderQueue::make_key(
+			program_ids(pipeline.program),
+			vao_ids(pipeline.vao),
+			texture_ids(texture_set(pipeline.textures)),
+			depth
+		), uint32_t(queued_drawables.size()));
+		queued_drawables.emplace_back(&drawable);
+	}
+	for (auto const &instanced : instanced_drawables) {
+		//Reference to instanced drawable's pipeline for convenience:
+		Scene::InstancedDrawable::Pipeline const &pipeline = instanced.pipeline;
+
+		//skip any instanced drawables without a shader program, vertex array, or instance buffer set:
+		if (pipeline.program == 0) continue;
+		if (pipeline.vao == 0) continue;
+		if (pipeline.instance_buffer == 0) continue;
+		//skip any instanced drawables that don't contain any vertices or instances:
+		if (pipeline.count == 0) continue;
+		if (instanced.instances.empty()) continue;
+
+		render_queue.push(RenderQueue::make_key(
+			program_ids(pipeline.program),
+			vao_ids(pipeline.vao),
+			texture_ids(texture_set(pipeline.textures)),
+			0.0f
+		), uint32_t(queued_drawables.size() + queued_instanced.size()));
+		queued_instanced.emplace_back(&instanced);
+	}
 
-		//the object-to-light matrix is used in the next two uniforms:
-		glm::mat4x3 object_to_light = world_to_light * glm::mat4(object_to_world);
+	render_queue.sort();
 
-		//OBJECT_TO_CLIP takes vertices from object space to light space:
-		if (pipeline.OBJECT_TO_LIGHT_mat4x3 != -1U) {
-			glUniformMatrix4x3fv(pipeline.OBJECT_TO_LIGHT_mat4x3, 1, GL_FALSE, glm::value_ptr(object_to_light));
-		}
+	//Send everything to OpenGL in sorted order, only changing state when it differs from the previous draw:
+	draw_stats = RenderQueue::Stats();
+	DrawState state(draw_stats);
+	std::vector< glm::mat4x3 > object_to_world; //(re-used for each instanced drawable)
+	for (auto const &entry : render_queue.entries) {
+		if (entry.item < queued_drawables.size()) {
+			Drawable const &drawable = *queued_drawables[entry.item];
+			Scene::Drawable::Pipeline const &pipeline = drawable.pipeline;
 
-		//NORMAL_TO_CLIP takes normals from object space to light space:
-		if (pipeline.NORMAL_TO_LIGHT_mat3 != -1U) {
-			glm::mat3 normal_to_light = glm::inverse(glm::transpose(glm::mat3(object_to_light)));
-			glUniformMatrix3fv(pipeline.NORMAL_TO_LIGHT_mat3, 1, GL_FALSE, glm::value_ptr(normal_to_light));
-		}
+			//Set shader program and attribute sources:
+			state.use_program(pipeline.program);
+			state.bind_vao(pipeline.vao);
 
-		//set any requested custom uniforms:
-		if (pipeline.set_uniforms) pipeline.set_uniforms();
+			//Configure program uniforms:
 
-		//set up textures:
-		for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
-			if (pipeline.textures[i].texture != 0) {
-				glActiveTexture(GL_TEXTURE0 + i);
-				glBindTexture(pipeline.textures[i].target, pipeline.textures[i].texture);
+			//the object-to-world matrix is used in all three of these uniforms:
+			glm::mat4x3 const &object_to_world = drawable.transform->cached_local_to_world();
+
+			//OBJECT_TO_CLIP takes vertices from object space to clip space:
+			if (pipeline.OBJECT_TO_CLIP_mat4 != -1U) {
+				glm::mat4 object_to_clip = world_to_clip * glm::mat4(object_to_world);
+				glUniformMatrix4fv(pipeline.OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(object_to_clip));
 			}
-		}
 
-		//draw the object:
-		glDrawArrays(pipeline.type, pipeline.start, pipeline.count);
+			//the object-to-light matrix is used in the next two uniforms:
+			glm::mat4x3 object_to_light = world_to_light * glm::mat4(object_to_world);
 
-		//un-bind textures:
-		for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
-			if (pipeline.textures[i].texture != 0) {
-				glActiveTexture(GL_TEXTURE0 + i);
-				glBindTexture(pipeline.textures[i].target, 0);
+			//OBJECT_TO_CLIP takes vertices from object space to light space:
+			if (pipeline.OBJECT_TO_LIGHT_mat4x3 != -1U) {
+				glUniformMatrix4x3fv(pipeline.OBJECT_TO_LIGHT_mat4x3, 1, GL_FALSE, glm::value_ptr(object_to_light));
 			}
-		}
-		glActiveTexture(GL_TEXTURE0);
 
+			//NORMAL_TO_CLIP takes normals from object space to light space:
+			if (pipeline.NORMAL_TO_LIGHT_mat3 != -1U) {
+				glm::mat3 normal_to_light = glm::inverse(glm::transpose(glm::mat3(object_to_light)));
+				glUniformMatrix3fv(pipeline.NORMAL_TO_LIGHT_mat3, 1, GL_FALSE, glm::value_ptr(normal_to_light));
+			}
+
+			//vertex decoding:
+			set_decode_uniforms(pipeline);
+
+			//set any requested custom uniforms:
+			if (pipeline.set_uniforms) pipeline.set_uniforms();
+
+			//set up textures:
+			state.bind_textures(pipeline.textures);
+			state.count_unsorted(pipeline.textures);
+
+			//draw the object:
+			if (pipeline.index_type == GL_NONE) {
+				glDrawArrays(pipeline.type, pipeline.start, pipeline.count);
+			} else {
+				glDrawElements(pipeline.type, pipeline.count, pipeline.index_type, element_offset(pipeline.index_type, pipeline.start));
+			}
+		} else {
+			//Instanced drawables are sent to OpenGL with one draw call each:
+			InstancedDrawable const &instanced = *queued_instanced[entry.item - queued_drawables.size()];
+			Scene::InstancedDrawable::Pipeline const &pipeline = instanced.pipeline;
+
+			//Gather object-to-world matrices of (visible) instances and upload to the instance buffer:
+			object_to_world.clear();
+			object_to_world.reserve(instanced.instances.size());
+			if (has_bounds(pipeline.min, pipeline.max)) {
+				batch.clear();
+				for (Transform const *transform : instanced.instances) {
+					assert(transform); //instances *must* have a transform
+					batch.add(Frustum::bounding_sphere(transform->cached_local_to_world(), pipeline.min, pipeline.max));
+				}
+				batch.cull(frustum, cull_stats);
+				for (uint32_t i = 0; i < instanced.instances.size(); ++i) {
+					if (batch.is_visible(i)) object_to_world.emplace_back(instanced.instances[i]->cached_local_to_world());
+				}
+				if (object_to_world.empty()) continue;
+			} else {
+				for (Transform const *transform : instanced.instances) {
+					assert(transform); //instances *must* have a transform
+					object_to_world.emplace_back(transform->cached_local_to_world());
+				}
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, pipeline.instance_buffer);
+			glBufferData(GL_ARRAY_BUFFER, object_to_world.size() * sizeof(glm::mat4x3), object_to_world.data(), GL_STREAM_DRAW);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+			//Set shader program and attribute sources:
+			state.use_program(pipeline.program);
+			state.bind_vao(pipeline.vao);
+
+			//Configure program uniforms:
+			// (object-to-world happens in the shader, per instance)
+			if (pipeline.WORLD_TO_CLIP_mat4 != -1U) {
+				glUniformMatrix4fv(pipeline.WORLD_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(world_to_clip));
+			}
+			if (pipeline.WORLD_TO_LIGHT_mat4x3 != -1U) {
+				glUniformMatrix4x3fv(pipeline.WORLD_TO_LIGHT_mat4x3, 1, GL_FALSE, glm::value_ptr(world_to_light));
+			}
+
+			//vertex decoding:
+			set_decode_uniforms(pipeline);
+
+			//set any requested custom uniforms:
+			if (pipeline.set_uniforms) pipeline.set_uniforms();
+
+			//set up textures:
+			state.bind_textures(pipeline.textures);
+			state.count_unsorted(pipeline.textures);
+
+			//draw all the instances:
+			if (pipeline.index_type == GL_NONE) {
+				glDrawArraysInstanced(pipeline.type, pipeline.start, pipeline.count, GLsizei(object_to_world.size()));
+			} else {
+				glDrawElementsInstanced(pipeline.type, pipeline.count, pipeline.index_type, element_offset(pipeline.index_type, pipeline.start), GLsizei(object_to_world.size()));
+			}
+		}
 	}
 
-	glUseProgram(0);
-	glBindVertexArray(0);
+	//un-bind textures, program, and vertex array:
+	state.reset();
+	draw_stats.state_changes_saved = state.unsorted_changes - std::min(state.unsorted_changes, draw_stats.state_changes());
 
 	GL_ERRORS();
 }
 
-
 void Scene::load(std::string const &filename,
 	std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable) {
 
-	std::ifstream file(filename, std::ios::binary);
+	//(chunks are parsed in place from the mapped file, in whatever order they were written; see ChunkFile.hpp)
+	ChunkFile file(filename);
+	load_note_read(file.size);
 
-	std::vector< char > names;
-	read_chunk(file, "str0", &names);
+	ChunkFile::Span< char > names = file.find< char >("str0");
 
 	struct HierarchyEntry {
 		uint32_t parent;
@@ -183,8 +492,7 @@ void Scene::load(std::string const &filename,
 		glm::vec3 scale;
 	};
 	static_assert(sizeof(HierarchyEntry) == 4 + 4 + 4 + 4*3 + 4*4 + 4*3, "HierarchyEntry is packed.");
-	std::vector< HierarchyEntry > hierarchy;
-	read_chunk(file, "xfh0", &hierarchy);
+	ChunkFile::Span< HierarchyEntry > hierarchy = file.find< HierarchyEntry >("xfh0");
 
 	struct MeshEntry {
 		uint32_t transform;
@@ -192,8 +500,7 @@ void Scene::load(std::string const &filename,
 		uint32_t name_end;
 	};
 	static_assert(sizeof(MeshEntry) == 4 + 4 + 4, "MeshEntry is packed.");
-	std::vector< MeshEntry > meshes;
-	read_chunk(file, "msh0", &meshes);
+	ChunkFile::Span< MeshEntry > meshes = file.find< MeshEntry >("msh0");
 
 	struct CameraEntry {
 		uint32_t transform;
@@ -202,8 +509,7 @@ void Scene::load(std::string const &filename,
 		float clip_near, clip_far;
 	};
 	static_assert(sizeof(CameraEntry) == 4 + 4 + 4 + 4 + 4, "CameraEntry is packed.");
-	std::vector< CameraEntry > loaded_cameras;
-	read_chunk(file, "cam0", &loaded_cameras);
+	ChunkFile::Span< CameraEntry > loaded_cameras = file.find< CameraEntry >("cam0");
 
 	struct LightEntry {
 		uint32_t transform;
@@ -214,8 +520,7 @@ void Scene::load(std::string const &filename,
 		float fov;
 	};
 	static_assert(sizeof(LightEntry) == 4 + 1 + 3 + 4 + 4 + 4, "LightEntry is packed.");
-	std::vector< LightEntry > loaded_lights;
-	read_chunk(file, "lmp0", &loaded_lights);
+	ChunkFile::Span< LightEntry > loaded_lights = file.find< LightEntry >("lmp0");
 
 
 	//--------------------------------
@@ -304,7 +609,7 @@ void Scene::load(std::string const &filename,
 	//load any extra that a subclass wants:
 	load_extra(file, names, hierarchy_transforms);
 
-	if (file.peek() != EOF) {
+	if (file.trailing_bytes) {
 		std::cerr << "WARNING: trailing data in scene file '" << filename << "'" << std::endl;
 	}
 
@@ -314,6 +619,93 @@ void Scene::load(std::string const &filename,
 
 //-------------------------
 
+void Scene::instantiate(Scene const &templ, uint32_t count, uint32_t first_index, std::vector< Transform * > *added) {
+	assert(&templ != this && "can't instantiate a scene into itself");
+
+	//number the template's transforms once, so that per-copy fixup is just index arithmetic:
+	std::unordered_map< Transform const *, uint32_t > template_index;
+	template_index.reserve(templ.transforms.size());
+	std::vector< Transform const * > template_transforms;
+	template_transforms.reserve(templ.transforms.size());
+	for (auto const &t : templ.transforms) {
+		template_index.emplace(&t, uint32_t(template_transforms.size()));
+		template_transforms.emplace_back(&t);
+	}
+	uint32_t const per_copy = uint32_t(template_transforms.size());
+
+	std::vector< uint32_t > parent_index;
+	parent_index.reserve(per_copy);
+	for (Transform const *t : template_transforms) {
+		if (t->parent) {
+			auto f = template_index.find(t->parent);
+			if (f == template_index.end()) throw std::runtime_error("template transform '" + t->name + "' has a parent outside of the template.");
+			parent_index.emplace_back(f->second);
+		} else {
+			parent_index.emplace_back(-1U);
+		}
+	}
+
+	//stamp out transforms:
+	std::vector< Transform * > stamped;
+	stamped.reserve(size_t(count) * per_copy);
+	for (uint32_t c = 0; c < count; ++c) {
+		std::string suffix = std::to_string(first_index + c);
+		Transform **copy = stamped.data() + stamped.size();
+		for (Transform const *t : template_transforms) {
+			transforms.emplace_back();
+			Transform &n = transforms.back();
+			n.name = t->name + suffix;
+			n.position = t->position;
+			n.rotation = t->rotation;
+			n.scale = t->scale;
+			stamped.emplace_back(&n);
+		}
+		for (uint32_t i = 0; i < per_copy; ++i) {
+			if (parent_index[i] != -1U) copy[i]->parent = copy[parent_index[i]];
+		}
+	}
+
+	//helper to look up copy c of a template transform:
+	auto lookup = [&](Transform const *t, uint32_t c) -> Transform * {
+		return stamped[size_t(c) * per_copy + template_index.at(t)];
+	};
+
+	//copy drawables, cameras, and lights once per copy:
+	for (uint32_t c = 0; c < count; ++c) {
+		for (auto const &d : templ.drawables) {
+			drawables.emplace_back(d);
+			drawables.back().transform = lookup(d.transform, c);
+		}
+		for (auto const &cam : templ.cameras) {
+			cameras.emplace_back(cam);
+			cameras.back().transform = lookup(cam.transform, c);
+		}
+		for (auto const &l : templ.lights) {
+			lights.emplace_back(l);
+			lights.back().transform = lookup(l.transform, c);
+		}
+	}
+
+	//merge all copies of each instanced drawable:
+	for (auto const &d : templ.instanced_drawables) {
+		instanced_drawables.emplace_back();
+		InstancedDrawable &n = instanced_drawables.back();
+		n.pipeline = d.pipeline;
+		n.instances.reserve(size_t(count) * d.instances.size());
+		for (uint32_t c = 0; c < count; ++c) {
+			for (Transform const *t : d.instances) {
+				n.instances.emplace_back(lookup(t, c));
+			}
+		}
+	}
+
+	if (added) {
+		added->insert(added->end(), stamped.begin(), stamped.end());
+	}
+}
+
+//-------------------------
+
 Scene::Scene(std::string const &filename, std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable) {
 	load(filename, on_drawable);
 }
@@ -327,51 +719,101 @@ Scene &Scene::operator=(Scene const &other) {
 	return *this;
 }
 
-void Scene::set(Scene const &other, std::unordered_map< Transform const *, Transform * > *transform_map_) {
+void Scene::set(Scene const &other, std::unordered_map< Transform const *, Transform * > *transform_map) {
+	if (&other == this) return;
 
-	std::unordered_map< Transform const *, Transform * > t2t_temp;
-	std::unordered_map< Transform const *, Transform * > &transform_to_transform = *(transform_map_ ? transform_map_ : &t2t_temp);
-
-	transform_to_transform.clear();
-
-	//null transform maps to itself:
-	transform_to_transform.insert(std::make_pair(nullptr, nullptr));
-
-	//Copy transforms and store mapping:
-	transforms.clear();
-	for (auto const &t : other.transforms) {
-		transforms.emplace_back();
-		transforms.back().name = t.name;
-		transforms.back().position = t.position;
-		transforms.back().rotation = t.rotation;
-		transforms.back().scale = t.scale;
-		transforms.back().parent = t.parent; //will update later
-
-		//store mapping between transforms old and new:
-		auto ret = transform_to_transform.insert(std::make_pair(&t, &transforms.back()));
-		assert(ret.second);
-	}
+	//Every object is copied into the same arena slot it has in 'other', so pointer fixup is just
+	// "find slot index in other, look up same index here" -- no hashing, and no per-object allocation:
+	auto to_here = [&](Transform const *t) -> Transform * {
+		return t ? transforms.at_index(other.transforms.index_of(t)) : nullptr;
+	};
 
-	//update transform parents:
+	//Copy transforms:
+	// (order -- and so parents-before-children -- is the same as in 'other')
+	transforms.copy_slots(other.transforms, [](Transform *slot, Transform const &from) {
+		Transform *t = new (slot) Transform();
+		t->name = from.name;
+		t->position = from.position;
+		t->rotation = from.rotation;
+		t->scale = from.scale;
+		t->parent = from.parent; //(fixed up below, once all transforms exist)
+		t->cache = from.cache;
+	});
 	for (auto &t : transforms) {
-		t.parent = transform_to_transform.at(t.parent);
+		Transform const *parent = t.parent;
+		t.parent = to_here(parent);
+		//cached world matrices are shared with 'other', so unchanged transforms won't be recomputed:
+		// (cache is only valid if it was computed for the current parent; if not, point it at t itself,
+		//  which can never be t's parent, so the next update_world_matrices() recomputes it)
+		t.cache.parent = (t.cache.parent == parent ? t.parent : &t);
+	}
+	//(cache.pass values came from other's update passes, so continue numbering from there)
+	update_pass = other.update_pass;
+
+	if (transform_map) {
+		transform_map->clear();
+		transform_map->reserve(other.transforms.size() + 1);
+		transform_map->insert(std::make_pair(nullptr, nullptr));
+		for (auto const &t : other.transforms) {
+			transform_map->insert(std::make_pair(&t, to_here(&t)));
+		}
 	}
 
 	//copy other's drawables, updating transform pointers:
-	drawables = other.drawables;
-	for (auto &d : drawables) {
-		d.transform = transform_to_transform.at(d.transform);
-	}
+	drawables.copy_slots(other.drawables, [&](Drawable *slot, Drawable const &from) {
+		new (slot) Drawable(from);
+		slot->transform = to_here(from.transform);
+	});
+
+	//copy other's instanced drawables, updating transform pointers:
+	instanced_drawables.copy_slots(other.instanced_drawables, [&](InstancedDrawable *slot, InstancedDrawable const &from) {
+		new (slot) InstancedDrawable(from);
+		for (auto &t : slot->instances) {
+			t = to_here(t);
+		}
+	});
 
 	//copy other's cameras, updating transform pointers:
-	cameras = other.cameras;
-	for (auto &c : cameras) {
-		c.transform = transform_to_transform.at(c.transform);
-	}
+	cameras.copy_slots(other.cameras, [&](Camera *slot, Camera const &from) {
+		new (slot) Camera(from);
+		slot->transform = to_here(from.transform);
+	});
 
 	//copy other's lights, updating transform pointers:
-	lights = other.lights;
-	for (auto &l : lights) {
-		l.transform = transform_to_transform.at(l.transform);
+	lights.copy_slots(other.lights, [&](Light *slot, Light const &from) {
+		new (slot) Light(from);
+		slot->transform = to_here(from.transform);
+	});
+}
+
+void Scene::reload(Scene const &fresh, std::unordered_map< Transform const *, Transform * > *transform_map) {
+	if (&fresh == this) return;
+
+	//note the live state of every transform by name (first one wins if names repeat):
+	struct Live {
+		Transform const *transform; //(only used as a key once the scene is replaced)
+		glm::vec3 position;
+		glm::quat rotation;
+		glm::vec3 scale;
+	};
+	std::unordered_map< std::string, Live > live;
+	live.reserve(transforms.size());
+	for (auto const &t : transforms) {
+		live.emplace(t.name, Live{&t, t.position, t.rotation, t.scale});
+	}
+
+	set(fresh);
+
+	if (transform_map) {
+		transform_map->clear();
+		transform_map->insert(std::make_pair(nullptr, nullptr));
+	}
+	for (auto &t : transforms) {
+		auto f = live.find(t.name);
+		if (f == live.end()) continue;
+		t.position = f->second.position;
+		t.rotation = f->second.rotation;
+		t.scale = f->second.scale;
+		if (transform_map) transform_map->insert(std::make_pair(f->second.transform, &t));
 	}
 }
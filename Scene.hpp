@@ -5,19 +5,24 @@
  *
  * Each transformation may have associated:
  *  - Drawing data (via "Drawable")
+ *  - Instanced drawing data, shared with many other transforms (via "InstancedDrawable")
  *  - Camera information (via "Camera")
  *  - Light information (via "Light")
  *
  */
 
 #include "GL.hpp"
+#include "Arena.hpp"
+#include "RenderQueue.hpp"
+#include "Frustum.hpp"
+#include "ChunkFile.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
-#include <list>
 #include <memory>
 #include <functional>
+#include <limits>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -43,6 +48,29 @@ struct Scene {
 		glm::mat4x3 make_local_to_world() const;
 		glm::mat4x3 make_world_to_local() const;
 
+		//Cached versions of the world matrices, as of the last Scene::update_world_matrices():
+		// (these are cheap to call but, unlike make_*, won't reflect changes made since that update)
+		glm::mat4x3 const &cached_local_to_world() const;
+		glm::mat4x3 const &cached_world_to_local() const; //(computed on first use after a change)
+
+		//Cache bookkeeping, used by the functions above and Scene::update_world_matrices():
+		struct Cache {
+			//local values (and parent) that local_to_world was computed from:
+			glm::vec3 position = glm::vec3(0.0f);
+			glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+			glm::vec3 scale = glm::vec3(1.0f);
+			Transform const *parent = nullptr;
+			uint32_t parent_generation = 0; //parent's generation when local_to_world was computed
+
+			uint32_t generation = 0; //incremented whenever local_to_world changes (0 => never computed)
+			uint32_t world_to_local_generation = 0; //generation that world_to_local was computed for
+			uint32_t pass = 0; //last update pass that visited this transform
+
+			glm::mat4x3 local_to_world = glm::mat4x3(1.0f);
+			glm::mat4x3 world_to_local = glm::mat4x3(1.0f);
+		};
+		mutable Cache cache;
+
 		//since hierarchy is tracked through pointers, copy-constructing a transform  is not advised:
 		Transform(Transform const &) = delete;
 		//if we delete some constructors, we need to let the compiler know that the default constructor is still okay:
@@ -64,6 +92,21 @@ struct Scene {
 			GLenum type = GL_TRIANGLES; //what sort of primitive to draw; passed to glDrawArrays
 			GLuint start = 0; //first vertex to draw; passed to glDrawArrays
 			GLuint count = 0; //number of vertices to draw; passed to glDrawArrays
+			//if not GL_NONE, draw with glDrawElements instead; start and count are then a range of the vao's element buffer:
+			GLenum index_type = GL_NONE; //GL_UNSIGNED_SHORT or GL_UNSIGNED_INT (see Mesh::index_type)
+
+			//decoding for quantized vertices (see Mesh::position_scale); draw() sets these as uniforms if the program has them:
+			glm::vec3 position_scale = glm::vec3(1.0f);
+			glm::vec3 position_offset = glm::vec3(0.0f);
+			bool octahedral_normals = false;
+			GLuint POSITION_SCALE_vec3 = -1U;
+			GLuint POSITION_OFFSET_vec3 = -1U;
+			GLuint OCTAHEDRAL_NORMALS_bool = -1U;
+
+			//object-space bounding box of the vertices, used for view-frustum culling in draw():
+			// (the default, empty box means "bounds unknown" -- such drawables are never culled)
+			glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
+			glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
 
 			//uniforms:
 			GLuint OBJECT_TO_CLIP_mat4 = -1U; //uniform location for object to clip space matrix
@@ -81,6 +124,52 @@ struct Scene {
 		} pipeline;
 	};
 
+	struct InstancedDrawable {
+		//an 'InstancedDrawable' draws the same vertices once for each of a list of transforms,
+		// using a single instanced draw call:
+		InstancedDrawable() = default;
+		InstancedDrawable(std::vector< Transform * > const &instances_) : instances(instances_) { }
+		std::vector< Transform * > instances;
+
+		//Contains all the data needed to run the OpenGL pipeline:
+		// (differs from Drawable::Pipeline in that object-to-world is a per-instance attribute)
+		struct Pipeline {
+			GLuint program = 0; //shader program; passed to glUseProgram
+
+			//attributes:
+			GLuint vao = 0; //attrib->buffer mapping; must source the per-instance OBJECT_TO_WORLD attribute from instance_buffer
+			GLuint instance_buffer = 0; //per-instance object-to-world matrices (glm::mat4x3) are streamed here every draw
+
+			GLenum type = GL_TRIANGLES; //what sort of primitive to draw; passed to glDrawArraysInstanced
+			GLuint start = 0; //first vertex to draw; passed to glDrawArraysInstanced
+			GLuint count = 0; //number of vertices to draw; passed to glDrawArraysInstanced
+			GLenum index_type = GL_NONE; //if not GL_NONE, draw with glDrawElementsInstanced (as in Drawable::Pipeline)
+
+			//decoding for quantized vertices (as in Drawable::Pipeline):
+			glm::vec3 position_scale = glm::vec3(1.0f);
+			glm::vec3 position_offset = glm::vec3(0.0f);
+			bool octahedral_normals = false;
+			GLuint POSITION_SCALE_vec3 = -1U;
+			GLuint POSITION_OFFSET_vec3 = -1U;
+			GLuint OCTAHEDRAL_NORMALS_bool = -1U;
+
+			//object-space bounding box of the vertices; each instance is culled separately in draw():
+			// (as with Drawable::Pipeline, the default empty box means "never cull")
+			glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
+			glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+
+			//uniforms:
+			GLuint WORLD_TO_CLIP_mat4 = -1U; //uniform location for world to clip space matrix
+			GLuint WORLD_TO_LIGHT_mat4x3 = -1U; //uniform location for world to light space matrix
+
+			std::function< void() > set_uniforms; //(optional) function to set any other useful uniforms
+
+			//texture objects to bind for the first TextureCount textures:
+			enum : uint32_t { TextureCount = Drawable::Pipeline::TextureCount };
+			Drawable::Pipeline::TextureInfo textures[TextureCount];
+		} pipeline;
+	};
+
 	struct Camera {
 		//a 'Camera' attaches camera data to a transform:
 		Camera(Transform *transform_) : transform(transform_) { assert(transform); }
@@ -117,10 +206,22 @@ struct Scene {
 	};
 
 	//Scenes, of course, may have many of the above objects:
-	std::list< Transform > transforms;
-	std::list< Drawable > drawables;
-	std::list< Camera > cameras;
-	std::list< Light > lights;
+	// (Arenas keep objects in creation order in a few big blocks; pointers to objects stay valid, and
+	//  scene.transforms.handle_of(ptr) / scene.transforms.get(handle) convert to/from generational handles.)
+	// transforms are kept so that parents precede children (load(), instantiate(), and set() all preserve this)
+	Arena< Transform > transforms;
+	Arena< Drawable > drawables;
+	Arena< InstancedDrawable > instanced_drawables;
+	Arena< Camera > cameras;
+	Arena< Light > lights;
+
+	typedef Arena< Transform >::Handle TransformHandle;
+
+	//Bring every transform's cached world matrices up to date:
+	// only transforms whose position/rotation/scale/parent changed (or whose parent's world matrix changed) are recomputed.
+	// draw() calls this, so you only need to call it yourself if you use Transform::cached_* elsewhere.
+	void update_world_matrices() const;
+	mutable uint32_t update_pass = 0; //incremented by every update_world_matrices() call
 
 	//The "draw" function provides a convenient way to pass all the things in a scene to OpenGL:
 	void draw(Camera const &camera) const;
@@ -128,6 +229,16 @@ struct Scene {
 	//..sometimes, you want to draw with a custom projection matrix and/or light space:
 	void draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_light = glm::mat4x3(1.0f)) const;
 
+	//draw() sorts drawables by program, vertex array, textures, and depth (see RenderQueue.hpp) and skips redundant state changes:
+	// (n.b. this means drawables are *not* drawn in creation order)
+	mutable RenderQueue::Stats draw_stats; //state changes made (and saved) by the most recent draw()
+	//draw() also skips drawables (and instances) whose bounds are entirely outside the view frustum:
+	mutable CullStats cull_stats; //objects tested / culled by the most recent draw()
+	mutable RenderQueue render_queue; //(kept between draws to re-use its allocations)
+	mutable CullBatch cull_batch; //(ditto)
+	mutable std::vector< Drawable const * > cull_candidates; //(ditto)
+	mutable std::vector< uint32_t > cull_candidate_spheres; //(ditto)
+
 	//add transforms/objects/cameras from a scene file to this scene:
 	// the 'on_drawable' callback gives your code a chance to look up mesh data and make Drawables:
 	// throws on file format errors
@@ -137,17 +248,36 @@ struct Scene {
 
 	//this function is called to read extra chunks from the scene file after the main chunks are read:
 	// this is useful if you, e.g., subclassing scene to represent a game level/area
-	virtual void load_extra(std::istream &from, std::vector< char > const &str0, std::vector< Transform * > const &xfh0) { }
+	// (look up extra chunks with from.find< T >(magic); chunks a loader doesn't ask for are simply skipped)
+	virtual void load_extra(ChunkFile &from, ChunkFile::Span< char > const &str0, std::vector< Transform * > const &xfh0) { }
+
+	//add 'count' copies of the contents of scene 'templ' to this scene:
+	// this is much faster than calling load() 'count' times, since the file is only read (and on_drawable only called) once
+	//  -- when loading 'templ' -- and the copies just need transform indices remapped.
+	// transform names get the copy number appended (i.e., copy i of "Snow" is named "Snow" + std::to_string(first_index + i))
+	// each Drawable, Camera, and Light in 'templ' is copied once per copy
+	// each InstancedDrawable in 'templ' becomes *one* InstancedDrawable here, with the instances of all the copies
+	// if 'added' is non-null, the new transforms are appended to it (all of copy 0, then all of copy 1, etc.)
+	void instantiate(Scene const &templ, uint32_t count, uint32_t first_index = 0, std::vector< Transform * > *added = nullptr);
 
 	//empty scene:
 	Scene() = default;
+	virtual ~Scene() = default; //(scenes may be subclassed to load_extra() chunks, and deleted through Scene *)
 
 	//load a scene:
 	Scene(std::string const &filename, std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable);
 
 	//copy a scene (with proper pointer fixup):
+	// objects land in the same arena slots as in the source, so fixup is index arithmetic (no hashing);
+	// cached world matrices are copied too, so the first draw of the copy only recomputes transforms changed since.
 	Scene(Scene const &); //...as a constructor
 	Scene &operator=(Scene const &); //...as scene = scene
-	//... as a set() function that optionally returns the transform->transform mapping:
+	//... as a set() function that optionally returns the transform->transform mapping (building it costs extra):
 	void set(Scene const &, std::unordered_map< Transform const *, Transform * > *transform_map = nullptr);
+
+	//replace this scene's contents with those of 'fresh' (e.g., re-loaded after its file changed; see HotReload.hpp),
+	// but keep the current position, rotation, and scale of transforms whose names are in both:
+	// if transform_map is given, it maps each kept transform's old address to its new one (for fixing up pointers held elsewhere);
+	// transforms that aren't in 'fresh' are gone (and aren't in the map).
+	void reload(Scene const &fresh, std::unordered_map< Transform const *, Transform * > *transform_map = nullptr);
 };
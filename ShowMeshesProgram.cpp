@@ -1,5 +1,6 @@
 #include "ShowMeshesProgram.hpp"
 
+#include "Mesh.hpp"
 #include "gl_compile_program.hpp"
 #include "gl_errors.hpp"
 
@@ -14,6 +15,10 @@ Load< ShowMeshesProgram > show_meshes_program(LoadTagEarly, []() -> ShowMeshesPr
 	show_meshes_program_pipeline.OBJECT_TO_LIGHT_mat4x3 = ret->OBJECT_TO_LIGHT_mat4x3;
 	show_meshes_program_pipeline.NORMAL_TO_LIGHT_mat3 = ret->NORMAL_TO_LIGHT_mat3;
 
+	show_meshes_program_pipeline.POSITION_SCALE_vec3 = ret->POSITION_SCALE_vec3;
+	show_meshes_program_pipeline.POSITION_OFFSET_vec3 = ret->POSITION_OFFSET_vec3;
+	show_meshes_program_pipeline.OCTAHEDRAL_NORMALS_bool = ret->OCTAHEDRAL_NORMALS_bool;
+
 	return ret;
 });
 
@@ -21,7 +26,8 @@ ShowMeshesProgram::ShowMeshesProgram() {
 	//Compile vertex and fragment shaders using the convenient 'gl_compile_program' helper function:
 	program = gl_compile_program(
 		//vertex shader:
-		"#version 330\n"
+		// (mesh_decode_glsl provides decode_position and decode_normal; see Mesh.hpp)
+		std::string("#version 330\n") + mesh_decode_glsl +
 		"uniform mat4 OBJECT_TO_CLIP;\n"
 		"uniform mat4x3 OBJECT_TO_LIGHT;\n"
 		"uniform mat3 NORMAL_TO_LIGHT;\n"
@@ -34,9 +40,10 @@ ShowMeshesProgram::ShowMeshesProgram() {
 		"out vec4 color;\n"
 		"out vec2 texCoord;\n"
 		"void main() {\n"
-		"	gl_Position = OBJECT_TO_CLIP * Position;\n"
-		"	position = OBJECT_TO_LIGHT * Position;\n"
-		"	normal = NORMAL_TO_LIGHT * Normal;\n"
+		"	vec4 p = decode_position(Position);\n"
+		"	gl_Position = OBJECT_TO_CLIP * p;\n"
+		"	position = OBJECT_TO_LIGHT * p;\n"
+		"	normal = NORMAL_TO_LIGHT * decode_normal(Normal);\n"
 		"	color = Color;\n"
 		"	texCoord = TexCoord;\n"
 		"}\n"
@@ -85,6 +92,17 @@ ShowMeshesProgram::ShowMeshesProgram() {
 	NORMAL_TO_LIGHT_mat3 = glGetUniformLocation(program, "NORMAL_TO_LIGHT");
 
 	INSPECT_MODE_int = glGetUniformLocation(program, "INSPECT_MODE");
+
+	POSITION_SCALE_vec3 = glGetUniformLocation(program, "POSITION_SCALE");
+	POSITION_OFFSET_vec3 = glGetUniformLocation(program, "POSITION_OFFSET");
+	OCTAHEDRAL_NORMALS_bool = glGetUniformLocation(program, "OCTAHEDRAL_NORMALS");
+
+	//default to no vertex decoding (Scene::draw sets these per-draw):
+	glUseProgram(program);
+	glUniform3f(POSITION_SCALE_vec3, 1.0f, 1.0f, 1.0f);
+	glUniform3f(POSITION_OFFSET_vec3, 0.0f, 0.0f, 0.0f);
+	glUniform1i(OCTAHEDRAL_NORMALS_bool, 0);
+	glUseProgram(0);
 }
 
 ShowMeshesProgram::~ShowMeshesProgram() {
@@ -24,6 +24,11 @@ struct ShowSceneProgram {
 	GLuint OBJECT_TO_LIGHT_mat4x3 = -1U;
 	GLuint NORMAL_TO_LIGHT_mat3 = -1U;
 
+	//vertex decoding (see mesh_decode_glsl in Mesh.hpp):
+	GLuint POSITION_SCALE_vec3 = -1U;
+	GLuint POSITION_OFFSET_vec3 = -1U;
+	GLuint OCTAHEDRAL_NORMALS_bool = -1U;
+
 	GLuint INSPECT_MODE_int = -1U; //0: basic lighting; 1: position only; 2: normal only; 3: color only; 4: texcoord only
 
 	//Textures:
@@ -0,0 +1,177 @@
+#include "SnowBatch.hpp"
+
+#include <algorithm>
+
+SnowBatch::SnowBatch(uint32_t count, SnowWorld::Config const &config, uint64_t seed, uint32_t threads) {
+	worlds.resize(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		worlds[i].rng = Rng(seed, i);
+		worlds[i].reset(config);
+	}
+
+	thread_count = (threads ? threads : std::max(1U, std::thread::hardware_concurrency()));
+	queues.reset(new Queue[thread_count]);
+
+	auto worker = [this](uint32_t thread) {
+		uint64_t seen = 0;
+		while (true) {
+			{
+				std::unique_lock< std::mutex > lock(wake_mutex);
+				wake_cv.wait(lock, [&]() { return quit || generation != seen; });
+				if (quit) return;
+				seen = generation;
+				running.fetch_add(1, std::memory_order_relaxed); //(with wake_mutex held; see step())
+			}
+			run(thread);
+			running.fetch_sub(1, std::memory_order_release);
+		}
+	};
+	for (uint32_t t = 1; t < thread_count; ++t) {
+		workers.emplace_back(worker, t);
+	}
+}
+
+SnowBatch::~SnowBatch() {
+	{
+		std::unique_lock< std::mutex > lock(wake_mutex);
+		quit = true;
+	}
+	wake_cv.notify_all();
+	for (auto &thread : workers) thread.join();
+}
+
+void SnowBatch::reset(Observation *observations) {
+	for (uint32_t i = 0; i < worlds.size(); ++i) {
+		worlds[i].reset(worlds[i].config);
+		observe(i, &observations[i]);
+	}
+}
+
+void SnowBatch::step(uint8_t const *actions, Observation *observations, float *rewards, uint8_t *dones) {
+	if (worlds.empty()) return;
+
+	{
+		//workers only start run() with wake_mutex held, so once none are still in run() from the
+		// previous step (looking for chunks to steal), none can be until this step is set up:
+		std::unique_lock< std::mutex > lock(wake_mutex);
+		while (running.load(std::memory_order_acquire) != 0) {
+			std::this_thread::yield();
+		}
+
+		step_actions = actions;
+		step_observations = observations;
+		step_rewards = rewards;
+		step_dones = dones;
+
+		//give each thread an equal share of the chunks to start with:
+		uint32_t chunks = uint32_t((worlds.size() + ChunkWorlds - 1) / ChunkWorlds);
+		chunks_left.store(chunks, std::memory_order_relaxed);
+		for (uint32_t t = 0; t < thread_count; ++t) {
+			std::lock_guard< std::mutex > queue_lock(queues[t].mutex);
+			queues[t].begin = uint32_t(uint64_t(chunks) * t / thread_count);
+			queues[t].end = uint32_t(uint64_t(chunks) * (t + 1) / thread_count);
+		}
+
+		generation += 1;
+	}
+	if (!workers.empty()) wake_cv.notify_all();
+
+	run(0);
+
+	//wait for chunks that other threads are still working on:
+	while (chunks_left.load(std::memory_order_acquire) != 0) {
+		std::this_thread::yield();
+	}
+}
+
+void SnowBatch::run(uint32_t thread) {
+	uint32_t chunk = 0;
+	while (take(thread, &chunk)) {
+		step_chunk(chunk);
+		chunks_left.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+bool SnowBatch::take(uint32_t thread, uint32_t *chunk) {
+	{ //next chunk of this thread's own share:
+		Queue &own = queues[thread];
+		std::lock_guard< std::mutex > lock(own.mutex);
+		if (own.begin < own.end) {
+			*chunk = own.begin++;
+			return true;
+		}
+	}
+
+	//...or, if that's done, steal the back half of another thread's share:
+	Queue &own = queues[thread];
+	for (uint32_t i = 1; i < thread_count; ++i) {
+		Queue &victim = queues[(thread + i) % thread_count];
+		std::unique_lock< std::mutex > own_lock(own.mutex, std::defer_lock);
+		std::unique_lock< std::mutex > victim_lock(victim.mutex, std::defer_lock);
+		std::lock(own_lock, victim_lock);
+		if (own.begin < own.end) { //(only this thread fills its queue, so this shouldn't happen -- but never overwrite a share)
+			*chunk = own.begin++;
+			return true;
+		}
+		if (victim.begin >= victim.end) continue;
+		uint32_t begin = victim.begin + (victim.end - victim.begin) / 2;
+		*chunk = begin;
+		own.begin = begin + 1;
+		own.end = victim.end;
+		victim.end = begin;
+		return true;
+	}
+	return false;
+}
+
+void SnowBatch::step_chunk(uint32_t chunk) {
+	uint32_t begin = chunk * ChunkWorlds;
+	uint32_t end = std::min(uint32_t(worlds.size()), begin + ChunkWorlds);
+	for (uint32_t i = begin; i < end; ++i) {
+		SnowWorld &world = worlds[i];
+		uint32_t points = world.points;
+		world.tick(Tick, step_actions[i]);
+		step_rewards[i] = float(world.points - points);
+		step_dones[i] = (world.game_over ? 1 : 0);
+		if (world.game_over) world.reset(world.config);
+		observe(i, &step_observations[i]);
+	}
+}
+
+void SnowBatch::observe(uint32_t i, Observation *observation) const {
+	SnowWorld const &world = worlds[i];
+	SnowWorld::Config const &config = world.config;
+
+	glm::vec3 globe = world.base_at + config.globe_offset;
+	globe.z += config.globe_elevation;
+
+	observation->base = glm::vec2(world.base_at - config.base_position);
+	observation->time_left = std::max(0.0f, config.time_limit - world.total_elapsed);
+	observation->points = float(world.points);
+
+	//find the closest flakes that could still be caught (insertion into a short sorted list):
+	constexpr uint32_t Flakes = Observation::Flakes;
+	float closest[Flakes]; //squared horizontal distance
+	uint32_t closest_flake[Flakes];
+	uint32_t found = 0;
+	float lowest = globe.z - config.globe_radius;
+	Particles const &snow = world.snow;
+	for (uint32_t f = 0; f < snow.size(); ++f) {
+		if (snow.z[f] < lowest) continue; //(already below the globe)
+		float dx = snow.x[f] - globe.x;
+		float dy = snow.y[f] - globe.y;
+		float d2 = dx * dx + dy * dy;
+		if (found == Flakes && d2 >= closest[Flakes - 1]) continue;
+		uint32_t at = (found < Flakes ? found++ : Flakes - 1);
+		while (at > 0 && closest[at - 1] > d2) {
+			closest[at] = closest[at - 1];
+			closest_flake[at] = closest_flake[at - 1];
+			--at;
+		}
+		closest[at] = d2;
+		closest_flake[at] = f;
+	}
+	for (uint32_t k = 0; k < Flakes; ++k) {
+		observation->flakes[k] = (k < found ? snow.position(closest_flake[k]) - globe : glm::vec3(0.0f));
+	}
+}
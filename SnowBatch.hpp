@@ -0,0 +1,89 @@
+#pragma once
+
+/*
+ * SnowBatch steps many independent SnowWorlds at once, spread across all
+ *  cores -- e.g., as environments for automated agents, which want thousands
+ *  of games stepped per second.
+ *
+ * step() advances every world by one tick: the worlds are split into chunks,
+ *  each thread starts on its own share of the chunks, and threads that run
+ *  out steal half of the remaining chunks of another thread. The calling
+ *  thread works too, and step() returns when every world has been stepped.
+ *
+ * Each world has its own Rng stream (derived from the batch's seed and the
+ *  world's index), so results don't depend on the number of threads.
+ *
+ */
+
+#include "SnowWorld.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct SnowBatch {
+	static constexpr float Tick = 1.0f / 60.0f; //(same as PlayMode::Tick)
+
+	//what an agent sees of one world (positions are relative to the world's config.base_position):
+	struct Observation {
+		glm::vec2 base; //base position
+		float time_left; //seconds until the game ends
+		float points; //flakes caught so far
+		//the flakes closest (horizontally) to the globe, closest first, relative to the globe:
+		static constexpr uint32_t Flakes = 8;
+		glm::vec3 flakes[Flakes];
+	};
+
+	//'threads' counts the calling thread; 0 means one thread per core:
+	SnowBatch(uint32_t worlds, SnowWorld::Config const &config, uint64_t seed, uint32_t threads = 0);
+	~SnowBatch();
+
+	SnowBatch(SnowBatch const &) = delete;
+	SnowBatch &operator=(SnowBatch const &) = delete;
+
+	//start a new game in every world, and write each world's observation:
+	void reset(Observation *observations);
+
+	//advance every world by one Tick, with world i holding buttons actions[i] (SnowWorld::Buttons bits):
+	// writes observations[i], rewards[i] (flakes caught during the tick), and dones[i] (1 if the game ended).
+	// Worlds whose game ended are reset, so their observation is the first of the next game.
+	void step(uint8_t const *actions, Observation *observations, float *rewards, uint8_t *dones);
+
+	std::vector< SnowWorld > worlds;
+
+	//-- internals ---
+	static constexpr uint32_t ChunkWorlds = 16; //worlds per chunk of work
+
+	//chunks [begin,end) not yet taken from a thread's share:
+	struct alignas(64) Queue {
+		std::mutex mutex;
+		uint32_t begin = 0;
+		uint32_t end = 0;
+	};
+	std::unique_ptr< Queue[] > queues; //one per thread (thread 0 is the one calling step())
+	uint32_t thread_count = 0;
+	std::vector< std::thread > workers; //threads 1 .. thread_count-1
+
+	//the step being run:
+	uint8_t const *step_actions = nullptr;
+	Observation *step_observations = nullptr;
+	float *step_rewards = nullptr;
+	uint8_t *step_dones = nullptr;
+	std::atomic< uint32_t > chunks_left{0}; //chunks not yet finished
+	std::atomic< uint32_t > running{0}; //workers in run() (step() waits for this to be zero before setting up the next step)
+
+	//workers sleep until the generation changes (or quit is set):
+	std::mutex wake_mutex;
+	std::condition_variable wake_cv;
+	uint64_t generation = 0;
+	bool quit = false;
+
+	void run(uint32_t thread); //take (and steal) chunks until there are none left
+	bool take(uint32_t thread, uint32_t *chunk); //take a chunk from this thread's share, or steal more; false if none are left
+	void step_chunk(uint32_t chunk);
+	void observe(uint32_t world, Observation *observation) const;
+};
@@ -0,0 +1,195 @@
+#include "SnowFall.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <cassert>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SNOW_FALL_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+//GCC and clang need to be told that a function may use AVX2 instructions;
+// MSVC will happily compile them anywhere:
+#if defined(SNOW_FALL_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+namespace {
+
+//reference implementation; also handles the partial block at the end of the arrays:
+void snow_fall_scalar(SnowFallParams const &params, size_t begin, size_t end,
+	float const *x, float const *y, float *z, float const *fall_speed,
+	uint8_t *captured, uint8_t *grounded) {
+
+	assert(begin % 8 == 0);
+	float const radius2 = params.radius * params.radius;
+	for (size_t block = begin; block < end; block += 8) {
+		uint8_t c = 0, g = 0;
+		for (size_t i = block; i < block + 8 && i < end; ++i) {
+			z[i] -= params.elapsed * fall_speed[i];
+			float dx = x[i] - params.center.x;
+			float dy = y[i] - params.center.y;
+			float dz = z[i] - params.center.z;
+			uint8_t bit = uint8_t(1 << (i - block));
+			if (dx * dx + dy * dy + dz * dz <= radius2) {
+				c |= bit;
+			} else if (z[i] < params.ground) {
+				g |= bit;
+			}
+		}
+		captured[block / 8] = c;
+		grounded[block / 8] = g;
+	}
+}
+
+#ifdef SNOW_FALL_X86
+
+//eight flakes per iteration as two four-wide halves:
+size_t snow_fall_sse2(SnowFallParams const &params, size_t count,
+	float const *x, float const *y, float *z, float const *fall_speed,
+	uint8_t *captured, uint8_t *grounded) {
+
+	__m128 const elapsed = _mm_set1_ps(params.elapsed);
+	__m128 const cx = _mm_set1_ps(params.center.x);
+	__m128 const cy = _mm_set1_ps(params.center.y);
+	__m128 const cz = _mm_set1_ps(params.center.z);
+	__m128 const radius2 = _mm_set1_ps(params.radius * params.radius);
+	__m128 const ground = _mm_set1_ps(params.ground);
+
+	size_t const blocks = count / 8;
+	for (size_t b = 0; b < blocks; ++b) {
+		int c = 0, g = 0;
+		for (size_t h = 0; h < 2; ++h) {
+			size_t i = b * 8 + h * 4;
+			__m128 pz = _mm_sub_ps(_mm_loadu_ps(z + i), _mm_mul_ps(elapsed, _mm_loadu_ps(fall_speed + i)));
+			_mm_storeu_ps(z + i, pz);
+
+			__m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i), cx);
+			__m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i), cy);
+			__m128 dz = _mm_sub_ps(pz, cz);
+			__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+			__m128 in = _mm_cmple_ps(d2, radius2);
+			__m128 low = _mm_andnot_ps(in, _mm_cmplt_ps(pz, ground));
+			c |= _mm_movemask_ps(in) << (h * 4);
+			g |= _mm_movemask_ps(low) << (h * 4);
+		}
+		captured[b] = uint8_t(c);
+		grounded[b] = uint8_t(g);
+	}
+	return blocks * 8;
+}
+
+TARGET_AVX2
+size_t snow_fall_avx2(SnowFallParams const &params, size_t count,
+	float const *x, float const *y, float *z, float const *fall_speed,
+	uint8_t *captured, uint8_t *grounded) {
+
+	__m256 const elapsed = _mm256_set1_ps(params.elapsed);
+	__m256 const cx = _mm256_set1_ps(params.center.x);
+	__m256 const cy = _mm256_set1_ps(params.center.y);
+	__m256 const cz = _mm256_set1_ps(params.center.z);
+	__m256 const radius2 = _mm256_set1_ps(params.radius * params.radius);
+	__m256 const ground = _mm256_set1_ps(params.ground);
+
+	size_t const blocks = count / 8;
+	for (size_t b = 0; b < blocks; ++b) {
+		size_t i = b * 8;
+		__m256 pz = _mm256_sub_ps(_mm256_loadu_ps(z + i), _mm256_mul_ps(elapsed, _mm256_loadu_ps(fall_speed + i)));
+		_mm256_storeu_ps(z + i, pz);
+
+		__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), cx);
+		__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), cy);
+		__m256 dz = _mm256_sub_ps(pz, cz);
+		//n.b. not using FMA here so results match the scalar path exactly:
+		__m256 d2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+
+		__m256 in = _mm256_cmp_ps(d2, radius2, _CMP_LE_OQ);
+		__m256 low = _mm256_andnot_ps(in, _mm256_cmp_ps(pz, ground, _CMP_LT_OQ));
+		captured[b] = uint8_t(_mm256_movemask_ps(in));
+		grounded[b] = uint8_t(_mm256_movemask_ps(low));
+	}
+	return blocks * 8;
+}
+
+bool cpu_has_avx2() {
+	#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) return false;
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!(osxsave && avx)) return false;
+	//make sure the OS saves ymm registers:
+	if ((_xgetbv(0) & 0x6) != 0x6) return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+	#else
+	return __builtin_cpu_supports("avx2");
+	#endif
+}
+
+#endif //SNOW_FALL_X86
+
+} //namespace
+
+char const *snow_fall_kernel_name(SnowFallKernel kernel) {
+	if (kernel == SnowFallScalar) return "scalar";
+	else if (kernel == SnowFallSSE2) return "sse2";
+	else if (kernel == SnowFallAVX2) return "avx2";
+	else return "unknown";
+}
+
+bool snow_fall_kernel_supported(SnowFallKernel kernel) {
+	if (kernel == SnowFallScalar) return true;
+	#ifdef SNOW_FALL_X86
+	if (kernel == SnowFallSSE2) return true; //SSE2 is baseline on x86-64 (and assumed on x86)
+	if (kernel == SnowFallAVX2) {
+		static bool has_avx2 = cpu_has_avx2(); //cache result of cpu_has_avx2()
+		return has_avx2;
+	}
+	#endif
+	return false;
+}
+
+SnowFallKernel snow_fall_best_kernel() {
+	static SnowFallKernel best = [](){
+		if (snow_fall_kernel_supported(SnowFallAVX2)) return SnowFallAVX2;
+		if (snow_fall_kernel_supported(SnowFallSSE2)) return SnowFallSSE2;
+		return SnowFallScalar;
+	}();
+	return best;
+}
+
+void snow_fall(
+	SnowFallParams const &params,
+	size_t count,
+	float const *x, float const *y, float *z, float const *fall_speed,
+	uint8_t *captured, uint8_t *grounded,
+	SnowFallKernel kernel) {
+
+	if (!snow_fall_kernel_supported(kernel)) {
+		throw std::runtime_error("Snow fall kernel '" + std::string(snow_fall_kernel_name(kernel)) + "' is not supported on this machine.");
+	}
+
+	//full blocks of eight go through the SIMD path (if any):
+	size_t done = 0;
+	#ifdef SNOW_FALL_X86
+	if (kernel == SnowFallAVX2) {
+		done = snow_fall_avx2(params, count, x, y, z, fall_speed, captured, grounded);
+	} else if (kernel == SnowFallSSE2) {
+		done = snow_fall_sse2(params, count, x, y, z, fall_speed, captured, grounded);
+	}
+	#endif
+
+	//whatever is left goes through the scalar path:
+	snow_fall_scalar(params, done, count, x, y, z, fall_speed, captured, grounded);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+/*
+ * Batch kernel that moves falling snow and checks whether it has been
+ *  caught by the globe or hit the ground.
+ *
+ * Works directly on the structure-of-arrays layout used by "Particles".
+ * Flakes are processed eight at a time using SSE2 or AVX2 when available,
+ *  with a plain scalar implementation as a fallback (and for reference).
+ *
+ */
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+enum SnowFallKernel : uint32_t {
+	SnowFallScalar,
+	SnowFallSSE2,
+	SnowFallAVX2,
+	SnowFallKernelCount //<-- just used to track # of kernels
+};
+
+//human-readable kernel name (for benchmarks / logging):
+char const *snow_fall_kernel_name(SnowFallKernel kernel);
+
+//is this kernel compiled in and supported by the current CPU?
+bool snow_fall_kernel_supported(SnowFallKernel kernel);
+
+//fastest supported kernel (detected once, on first call):
+SnowFallKernel snow_fall_best_kernel();
+
+struct SnowFallParams {
+	float elapsed = 0.0f; //seconds to integrate
+	glm::vec3 center = glm::vec3(0.0f); //globe center
+	float radius = 1.0f; //globe radius
+	float ground = 0.0f; //flakes below this z hit the ground
+};
+
+//integrate 'count' flakes:
+//   z[i] -= params.elapsed * fall_speed[i]
+//then (after integration) compute, for flake i, bit (i % 8) of byte (i / 8) of:
+//   captured: length((x,y,z)[i] - params.center) <= params.radius
+//   grounded: !captured && z[i] < params.ground
+// 'captured' and 'grounded' must have room for (count + 7) / 8 bytes.
+// Bits past 'count' in the last byte are set to zero.
+void snow_fall(
+	SnowFallParams const &params,
+	size_t count,
+	float const *x, float const *y, float *z, float const *fall_speed,
+	uint8_t *captured, uint8_t *grounded,
+	SnowFallKernel kernel = snow_fall_best_kernel()
+);
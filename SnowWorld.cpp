@@ -0,0 +1,134 @@
+#include "SnowWorld.hpp"
+
+#include "SnowFall.hpp"
+
+#include <cmath>
+
+void SnowWorld::reset(Config const &config_) {
+	config = config_;
+	tick_count = 0;
+	rotator = 0.0f;
+	total_elapsed = 0.0f;
+	points = 0;
+	game_over = false;
+	base_at = config.base_position;
+
+	snow = Particles();
+	snow.resize(config.copies);
+	snow_respawn.clear();
+	for (uint32_t i = 0; i < config.copies; ++i) {
+		snow_respawn.emplace_back(i);
+	}
+	respawn_snow();
+}
+
+void SnowWorld::respawn_snow() {
+	uint32_t count = uint32_t(snow_respawn.size());
+	if (count == 0) return;
+
+	//generate new positions + speeds for all the flakes at once:
+	snow_respawn_scratch.resize(4 * count);
+	float *x = snow_respawn_scratch.data();
+	float *y = x + count;
+	float *alt = y + count;
+	float *speed = alt + count;
+	rng.fill_disc(config.bound_radius - config.globe_radius, count, x, y);
+	rng.fill_uniform(config.snow_height - config.snow_height_variation, config.snow_height + config.snow_height_variation, count, alt);
+	rng.fill_uniform(config.snowfall_speed - config.snowfall_speed_variation, config.snowfall_speed + config.snowfall_speed_variation, count, speed);
+
+	//...and scatter them to the flakes:
+	for (uint32_t j = 0; j < count; ++j) {
+		uint32_t i = snow_respawn[j];
+		snow.set_position(i, config.base_position + glm::vec3(x[j], y[j], alt[j]));
+		snow.fall_speed[i] = speed[j];
+	}
+}
+
+void SnowWorld::tick(float elapsed, uint8_t buttons) {
+	snow_respawn.clear();
+
+	if (!game_over) {
+		// slowly rotates through [0,1):
+		rotator += elapsed / 5.0f;
+		rotator -= std::floor(rotator);
+	}
+	{ //move snow, and check which flakes were caught or hit the ground:
+		SnowFallParams fall;
+		fall.elapsed = elapsed;
+		fall.center = base_at + config.globe_offset;
+		fall.center.z += config.globe_elevation;
+		fall.radius = config.globe_radius;
+		fall.ground = config.ground;
+
+		snow_captured.resize((snow.size() + 7) / 8);
+		snow_grounded.resize((snow.size() + 7) / 8);
+		snow_fall(fall, snow.size(),
+			snow.x.data(), snow.y.data(), snow.z.data(), snow.fall_speed.data(),
+			snow_captured.data(), snow_grounded.data());
+
+		if (!game_over) {
+			for (uint32_t b = 0; b < snow_captured.size(); ++b) {
+				uint32_t captured = snow_captured[b];
+				uint32_t grounded = snow_grounded[b];
+				if ((captured | grounded) == 0) continue; //common case: nothing happened to these eight
+				for (uint32_t bit = 0; bit < 8; ++bit) {
+					if (captured & (1 << bit)) {
+						points++;
+						snow_respawn.emplace_back(b * 8 + bit);
+					} else if (grounded & (1 << bit)) {
+						snow_respawn.emplace_back(b * 8 + bit);
+					}
+				}
+			}
+			respawn_snow();
+		}
+	}
+
+	total_elapsed += elapsed;
+	game_over = total_elapsed > config.time_limit;
+
+	// move the globe:
+	{
+		//combine inputs into a move:
+		bool left = (buttons & ButtonLeft), right = (buttons & ButtonRight);
+		bool down = (buttons & ButtonDown), up = (buttons & ButtonUp);
+		glm::vec2 move = glm::vec2(0.0f);
+		if (left && !right) move.x = -1.0f;
+		if (!left && right) move.x = 1.0f;
+		if (down && !up) move.y = -1.0f;
+		if (!down && up) move.y = 1.0f;
+
+		//make it so that moving diagonally doesn't go faster:
+		if (move != glm::vec2(0.0f)) move = glm::normalize(move) * config.base_speed * elapsed;
+
+		base_at += move.x * config.move_right + move.y * config.move_forward;
+		glm::vec3 diff = base_at - config.base_position;
+		// stay within the circle
+		if (glm::length(diff) >= config.bound_radius) {
+			base_at = config.base_position + config.bound_radius * glm::normalize(diff);
+		}
+	}
+
+	tick_count += 1;
+}
+
+uint32_t SnowWorld::state_hash() const {
+	//FNV-1a over the bytes of everything the game depends on:
+	uint32_t hash = 0x811c9dc5;
+	auto add = [&hash](void const *data, size_t size) {
+		for (size_t i = 0; i < size; ++i) {
+			hash = (hash ^ reinterpret_cast< uint8_t const * >(data)[i]) * 0x01000193;
+		}
+	};
+	add(&tick_count, sizeof(tick_count));
+	add(&rotator, sizeof(rotator));
+	add(&total_elapsed, sizeof(total_elapsed));
+	add(&points, sizeof(points));
+	add(&base_at, sizeof(base_at));
+	add(&rng.state, sizeof(rng.state));
+	add(snow.x.data(), snow.size() * sizeof(float));
+	add(snow.y.data(), snow.size() * sizeof(float));
+	add(snow.z.data(), snow.size() * sizeof(float));
+	add(snow.fall_speed.data(), snow.size() * sizeof(float));
+	return hash;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+/*
+ * SnowWorld is the snow-catching game itself -- where the globe is, the
+ *  flakes, the score and the timer -- with no Scene, OpenGL, or SDL, so it can
+ *  be stepped anywhere (PlayMode draws one; SnowBatch steps many at once).
+ *
+ * A world advances only through tick(), and all of its randomness comes from
+ *  its own 'rng', so a world is determined by its config, its rng, and the
+ *  buttons held during each tick.
+ *
+ */
+
+#include "Particles.hpp"
+#include "Random.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+struct SnowWorld {
+	//buttons held during a tick (same bits as the low half of an InputRecording tick):
+	enum Buttons : uint8_t {
+		ButtonLeft = 1,
+		ButtonRight = 2,
+		ButtonDown = 4,
+		ButtonUp = 8,
+	};
+
+	//everything about a game that doesn't change while playing it:
+	// (PlayMode reads the positions and directions from the scene it draws; the defaults are the values
+	//  snow-globe.scene has now, for use without a scene -- e.g., by SnowBatch in bench-batch.cpp)
+	struct Config {
+		glm::vec3 base_position = glm::vec3(0.0f); //where the base starts (also the center of the area it moves in); "Base" is at the origin
+		glm::vec3 globe_offset = glm::vec3(0.0f); //globe position relative to the base; "Globe" is at the base's origin
+		//directions the buttons move the base (the camera's right and forward, flattened onto the ground):
+		glm::vec3 move_right = glm::vec3(0.0f, 1.0f, 0.0f);
+		glm::vec3 move_forward = glm::vec3(-0.9396927f, 0.0f, 0.0f); //(the camera looks 20 degrees down, so this isn't unit length)
+		float base_speed = 40.0f;
+		float bound_radius = 45.0f;
+		float globe_elevation = 4.2f;
+		float globe_radius = 5.6f;
+		float ground = -1.0f;
+		float snow_height = 80.0f;
+		float snow_height_variation = 30.0f;
+		float snowfall_speed = 10.0f;
+		float snowfall_speed_variation = 3.0f;
+		uint32_t copies = 200; //flakes
+		float time_limit = 60.0f;
+	};
+	Config config;
+
+	//start a new game (flakes are placed using rng):
+	void reset(Config const &config);
+
+	//advance the game by 'elapsed' seconds with 'buttons' (bits from Buttons) held:
+	void tick(float elapsed, uint8_t buttons);
+
+	//hash of the game state (to check that two runs match):
+	uint32_t state_hash() const;
+
+	//----- game state -----
+	Rng rng; //used for flake respawns
+	uint32_t tick_count = 0; //ticks since reset()
+	float rotator = 0.0f; //base spin, slowly rotating through [0,1)
+	float total_elapsed = 0.0f;
+	uint32_t points = 0;
+	bool game_over = false;
+	glm::vec3 base_at = glm::vec3(0.0f); //base position
+
+	Particles snow; //flake state (index is flake id)
+	std::vector< uint32_t > snow_respawn; //flakes sent back up into the sky by the latest tick (or reset)
+
+	//-- internals ---
+	std::vector< uint8_t > snow_captured, snow_grounded; //per-tick bitmasks (bit i % 8 of byte i / 8) filled by snow_fall()
+	std::vector< float > snow_respawn_scratch; //space for respawn_snow() to generate values into
+	void respawn_snow(); //send every flake in snow_respawn back up into the sky
+};
@@ -0,0 +1,170 @@
+#include "Trace.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic< bool > trace_enabled(false);
+
+namespace {
+	struct TraceEvent {
+		char const *name;
+		uint64_t ns; //steady clock time
+		char phase; //'B' or 'E'
+	};
+
+	//each thread's most recent events (written only by that thread):
+	// (slots are relaxed atomics -- plain stores on common hardware -- so trace_dump() can read them while the thread is writing;
+	//  'seq' is a sequence lock: odd while the slot is being written, then 2 * (event index + 1))
+	struct TraceSlot {
+		std::atomic< uint64_t > seq{0};
+		std::atomic< char const * > name{nullptr};
+		std::atomic< uint64_t > ns{0};
+		std::atomic< char > phase{0};
+	};
+	struct TraceRing {
+		static constexpr uint64_t RingEvents = 1 << 16;
+		std::unique_ptr< TraceSlot[] > events = std::unique_ptr< TraceSlot[] >(new TraceSlot[RingEvents]);
+		std::atomic< uint64_t > recorded{0}; //events ever recorded (event i is at i % RingEvents)
+		uint32_t tid = 0;
+	};
+
+	//rings outlive their threads (e.g., load workers), so their events can still be dumped:
+	std::mutex rings_mutex;
+	std::vector< std::unique_ptr< TraceRing > > &get_rings() {
+		static std::vector< std::unique_ptr< TraceRing > > rings;
+		return rings;
+	}
+	//...and rings of threads that have exited are reused by new threads:
+	std::vector< TraceRing * > &get_free_rings() {
+		static std::vector< TraceRing * > free_rings;
+		return free_rings;
+	}
+	struct ThreadRing {
+		TraceRing *ring = nullptr;
+		~ThreadRing() {
+			if (!ring) return;
+			std::unique_lock< std::mutex > lock(rings_mutex);
+			get_free_rings().emplace_back(ring);
+		}
+	};
+	thread_local ThreadRing thread_ring;
+
+	std::string trace_filename;
+	uint64_t trace_start_ns = 0; //(events from before the latest trace_start() are not written)
+
+	std::string json_escape(char const *str) {
+		std::string ret;
+		for (char const *c = str; *c; ++c) {
+			if (*c == '"' || *c == '\\') ret += '\\';
+			if (uint8_t(*c) >= 0x20) ret += *c;
+		}
+		return ret;
+	}
+
+	uint64_t now_ns() {
+		return uint64_t(std::chrono::duration_cast< std::chrono::nanoseconds >(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+}
+
+void trace_record(char const *name, char phase) {
+	uint64_t ns = now_ns();
+	if (!thread_ring.ring) {
+		std::unique_lock< std::mutex > lock(rings_mutex);
+		auto &free_rings = get_free_rings();
+		if (!free_rings.empty()) {
+			thread_ring.ring = free_rings.back();
+			free_rings.pop_back();
+		} else {
+			auto &rings = get_rings();
+			rings.emplace_back(std::make_unique< TraceRing >());
+			rings.back()->tid = uint32_t(rings.size());
+			thread_ring.ring = rings.back().get();
+		}
+	}
+	TraceRing &ring = *thread_ring.ring;
+	uint64_t i = ring.recorded.load(std::memory_order_relaxed);
+	TraceSlot &slot = ring.events[i % TraceRing::RingEvents];
+	slot.seq.store(2 * i + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release); //(a dump that sees any of the new fields also sees the odd seq)
+	slot.name.store(name, std::memory_order_relaxed);
+	slot.ns.store(ns, std::memory_order_relaxed);
+	slot.phase.store(phase, std::memory_order_relaxed);
+	slot.seq.store(2 * (i + 1), std::memory_order_release);
+	ring.recorded.store(i + 1, std::memory_order_release);
+}
+
+void trace_start(std::string const &filename) {
+	trace_filename = filename;
+	if (trace_enabled.load(std::memory_order_relaxed)) return;
+	trace_start_ns = now_ns();
+	std::cout << "Tracing; will write trace to '" << trace_filename << "'." << std::endl;
+	trace_enabled.store(true, std::memory_order_relaxed);
+}
+
+void trace_stop() {
+	if (!trace_enabled.load(std::memory_order_relaxed)) return;
+	trace_enabled.store(false, std::memory_order_relaxed);
+	trace_dump();
+}
+
+void trace_dump() {
+	if (trace_filename.empty()) return;
+
+	//Chrome trace event format (https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU):
+	std::ofstream trace(trace_filename, std::ios::binary);
+	trace << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+	trace << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"game\"}}";
+
+	std::unique_lock< std::mutex > lock(rings_mutex);
+	size_t written = 0;
+	std::vector< TraceEvent > events;
+	for (auto const &ring_ptr : get_rings()) {
+		TraceRing const &ring = *ring_ptr;
+
+		//copy out the ring, keeping only events after the last one its thread overwrote (or was writing) during the copy:
+		// (events overwritten during the copy are the oldest ones, so what's kept has no gaps)
+		uint64_t end = ring.recorded.load(std::memory_order_acquire);
+		uint64_t begin = (end > TraceRing::RingEvents ? end - TraceRing::RingEvents : 0);
+		events.clear();
+		for (uint64_t i = begin; i < end; ++i) {
+			TraceSlot const &slot = ring.events[i % TraceRing::RingEvents];
+			uint64_t seq = slot.seq.load(std::memory_order_acquire);
+			TraceEvent event{slot.name.load(std::memory_order_relaxed), slot.ns.load(std::memory_order_relaxed), slot.phase.load(std::memory_order_relaxed)};
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (seq != 2 * (i + 1) || slot.seq.load(std::memory_order_relaxed) != seq) {
+				events.clear();
+				continue;
+			}
+			events.emplace_back(event);
+		}
+
+		uint32_t depth = 0;
+		for (size_t e = 0; e < events.size(); ++e) {
+			TraceEvent const &event = events[e];
+			if (event.ns < trace_start_ns) continue;
+			if (event.phase == 'E') {
+				if (depth == 0) continue; //(its begin fell out of the ring)
+				depth -= 1;
+			} else {
+				depth += 1;
+			}
+			uint64_t ns = event.ns - trace_start_ns;
+			trace << ",\n{\"name\":\"" << json_escape(event.name) << "\",\"ph\":\"" << event.phase << "\",\"pid\":1,\"tid\":" << ring.tid
+			      << ",\"ts\":" << (ns / 1000) << "." << std::setw(3) << std::setfill('0') << (ns % 1000) << std::setfill(' ') << "}";
+			written += 1;
+		}
+	}
+	lock.unlock();
+
+	trace << "\n]}\n";
+	if (!trace) {
+		std::cerr << "WARNING: failed to write trace to '" << trace_filename << "'." << std::endl;
+	} else {
+		std::cout << "Wrote " << written << " trace events to '" << trace_filename << "'." << std::endl;
+	}
+}
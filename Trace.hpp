@@ -0,0 +1,58 @@
+#pragma once
+
+/*
+ * Lightweight tracing of where time goes, for looking at frame spikes offline.
+ *
+ * //instrument a block:
+ * void PlayMode::update(float elapsed) {
+ *     TraceScope trace("PlayMode::update");
+ *     ...
+ * }
+ *
+ * While tracing is on, each TraceScope records a begin and an end event
+ *  (a name pointer and a nanosecond timestamp) in a ring buffer belonging to
+ *  the thread it runs on; the rings keep the most recent 65536 events per
+ *  thread. trace_dump() writes them as Chrome trace-event JSON, which
+ *  chrome://tracing and ui.perfetto.dev can open.
+ *
+ * When a thread exits, its ring (with its events) is handed to the next new
+ *  thread that traces, so short-lived threads don't each add a ring.
+ *
+ * While tracing is off, a TraceScope costs a (relaxed) load and a branch.
+ *
+ * Names must outlive the trace (use string literals).
+ *
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+//checked by every TraceScope; set by trace_start / trace_stop:
+extern std::atomic< bool > trace_enabled;
+
+//start recording, to be written to 'filename' by trace_dump():
+void trace_start(std::string const &filename);
+
+//write everything in the rings to the trace file (tracing continues):
+// (call from the main thread; events recorded on other threads during the dump may be left out)
+void trace_dump();
+
+//dump and stop recording:
+void trace_stop();
+
+//(used by TraceScope)
+void trace_record(char const *name, char phase);
+
+struct TraceScope {
+	TraceScope(char const *name_) : name(trace_enabled.load(std::memory_order_relaxed) ? name_ : nullptr) {
+		if (name) trace_record(name, 'B');
+	}
+	~TraceScope() {
+		if (name) trace_record(name, 'E');
+	}
+	TraceScope(TraceScope const &) = delete;
+	TraceScope &operator=(TraceScope const &) = delete;
+
+	char const *name; //(nullptr if tracing was off when the scope started)
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+/*
+ * aligned_vector< T > is a std::vector whose storage starts on a 64-byte
+ *  (cache line) boundary.
+ *
+ * This is useful for structure-of-arrays data that gets streamed through
+ *  tight loops, since every array starts on a fresh cache line and can be
+ *  loaded with aligned SIMD instructions.
+ *
+ */
+
+#include <vector>
+#include <new>
+#include <cstddef>
+
+template< typename T, size_t Alignment >
+struct aligned_allocator {
+	static_assert(Alignment >= alignof(T), "Alignment should be at least the natural alignment of T.");
+	static_assert((Alignment & (Alignment - 1)) == 0, "Alignment should be a power of two.");
+
+	typedef T value_type;
+
+	//needed because of the non-type template parameter:
+	template< typename U >
+	struct rebind { typedef aligned_allocator< U, Alignment > other; };
+
+	aligned_allocator() = default;
+	template< typename U >
+	aligned_allocator(aligned_allocator< U, Alignment > const &) { }
+
+	T *allocate(size_t count) {
+		return static_cast< T * >(::operator new(count * sizeof(T), std::align_val_t(Alignment)));
+	}
+	void deallocate(T *ptr, size_t) {
+		::operator delete(ptr, std::align_val_t(Alignment));
+	}
+
+	template< typename U >
+	bool operator==(aligned_allocator< U, Alignment > const &) const { return true; }
+	template< typename U >
+	bool operator!=(aligned_allocator< U, Alignment > const &) const { return false; }
+};
+
+template< typename T >
+using aligned_vector = std::vector< T, aligned_allocator< T, 64 > >;
@@ -0,0 +1,82 @@
+//Benchmark for stepping many games at once with SnowBatch
+//Usage:
+//  bench-batch [worlds] [ticks] [max-threads]
+//Reports world-ticks/second for 1, 2, 4, ... threads (up to max-threads, which defaults to one per core).
+
+#include "SnowBatch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+	uint64_t worlds = 4096;
+	uint64_t ticks = 600;
+	uint64_t max_threads = std::max(1U, std::thread::hardware_concurrency());
+	bool ok = (argc <= 4);
+	try {
+		if (ok && argc > 1) worlds = std::stoull(argv[1]);
+		if (ok && argc > 2) ticks = std::stoull(argv[2]);
+		if (ok && argc > 3) max_threads = std::stoull(argv[3]);
+	} catch (std::logic_error &) { //(invalid_argument or out_of_range)
+		ok = false;
+	}
+	if (!ok || worlds == 0 || worlds > 0xffffffff || ticks == 0 || ticks > 0xffffffff || max_threads == 0 || max_threads > 1024) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [worlds] [ticks] [max-threads]" << std::endl;
+		return 1;
+	}
+
+	//every run gets the same actions (a random walk of held buttons):
+	std::vector< uint8_t > actions(size_t(worlds) * ticks);
+	Rng action_rng(0x5eed);
+	for (size_t a = 0; a < actions.size(); ++a) {
+		actions[a] = uint8_t(action_rng.next() & 0xf);
+	}
+
+	std::vector< SnowBatch::Observation > observations(worlds);
+	std::vector< float > rewards(worlds);
+	std::vector< uint8_t > dones(worlds);
+
+	double one_thread_rate = 0.0;
+	uint32_t reference_hash = 0;
+	for (uint32_t threads = 1; ; threads *= 2) {
+		if (threads > max_threads) threads = uint32_t(max_threads);
+
+		SnowBatch batch(uint32_t(worlds), SnowWorld::Config(), 0x5eed, threads);
+		batch.reset(observations.data());
+		double caught = 0.0;
+
+		auto before = std::chrono::high_resolution_clock::now();
+		for (uint32_t t = 0; t < ticks; ++t) {
+			batch.step(actions.data() + size_t(t) * worlds, observations.data(), rewards.data(), dones.data());
+			for (float r : rewards) caught += r;
+		}
+		auto after = std::chrono::high_resolution_clock::now();
+		double seconds = std::chrono::duration< double >(after - before).count();
+
+		//check that the thread count didn't change the results:
+		uint32_t hash = 0;
+		for (auto const &world : batch.worlds) {
+			hash = hash * 31 + world.state_hash();
+		}
+		if (threads == 1) {
+			reference_hash = hash;
+		} else if (hash != reference_hash) {
+			std::cerr << "WARNING: results with " << threads << " threads differ from results with one thread." << std::endl;
+		}
+
+		double rate = double(worlds) * ticks / seconds;
+		if (threads == 1) one_thread_rate = rate;
+		std::cout << threads << " thread" << (threads == 1 ? "" : "s") << ": "
+			<< rate / 1.0e6 << " M world-ticks/second"
+			<< " (" << (rate / one_thread_rate) << "x; " << seconds * 1000.0 / ticks << " ms/tick for " << worlds << " worlds; caught " << caught << ")"
+			<< std::endl;
+
+		if (threads == max_threads) break;
+	}
+
+	return 0;
+}
@@ -0,0 +1,177 @@
+//Benchmark for loading chunk files with and without chunk compression (see chunk_compression.hpp)
+//Usage:
+//  bench-load [repeats] [file ...]
+//(default files are the game's meshes and scenes in dist/; run from the repository root)
+//For each file, writes a plain and a compressed copy (same chunks, both with a toc) next to it,
+// then times opening each copy and reading every chunk -- with the file in the page cache ("warm")
+// and, on linux, after asking the kernel to drop it from the page cache ("cold").
+//Also reports decompression throughput, decoding chunks one at a time and with ChunkFile::decompress_all.
+//(the copies are removed afterward)
+
+#include "ChunkFile.hpp"
+#include "read_write_chunk.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//flush a file to disk and drop it from the page cache; returns false if that isn't possible here:
+static bool evict(std::string const &filename) {
+#if defined(__linux__)
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd == -1) return false;
+	fdatasync(fd); //(dirty pages can't be dropped)
+	bool ok = (posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0);
+	close(fd);
+	return ok;
+#else
+	(void)filename;
+	return false;
+#endif
+}
+
+//open a file and read every chunk, like MeshBuffer does; returns a checksum so the reads can't be skipped:
+static uint32_t load(std::string const &filename) {
+	ChunkFile file(filename);
+	file.decompress_all();
+	uint32_t sum = 0;
+	for (ChunkFile::Chunk &chunk : file.chunks) {
+		for (char c : file.view< char >(chunk)) sum = sum * 31 + uint8_t(c);
+	}
+	return sum;
+}
+
+static double seconds_since(std::chrono::high_resolution_clock::time_point before) {
+	return std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - before).count();
+}
+
+int main(int argc, char **argv) {
+	uint64_t repeats = 20;
+	std::vector< std::string > filenames;
+	bool ok = true;
+	try {
+		if (argc > 1) repeats = std::stoull(argv[1]);
+	} catch (std::logic_error &) { //(invalid_argument or out_of_range)
+		ok = false;
+	}
+	for (int i = 2; i < argc; ++i) filenames.emplace_back(argv[i]);
+	if (!ok || repeats == 0 || repeats > 0xffffffff) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [repeats] [file ...]" << std::endl;
+		return 1;
+	}
+	if (filenames.empty()) {
+		filenames = {"dist/snow.pnct", "dist/snow.scene", "dist/snow-globe.pnct", "dist/snow-globe.scene"};
+	}
+
+	std::cout << std::fixed << std::setprecision(3);
+	for (std::string const &filename : filenames) {
+		std::string plain_filename = filename + ".bench-plain";
+		std::string compressed_filename = filename + ".bench-compressed";
+
+		//write copies (chunks of known structs are shuffled with their element size, the rest as 4-byte values if they can be):
+		size_t raw_total = 0;
+		try {
+			ChunkFile file(filename);
+			ChunkTocWriter plain, compressed;
+			for (ChunkFile::Chunk &chunk : file.chunks) {
+				std::string magic(chunk.magic, 4);
+				ChunkFile::Span< char > data = file.view< char >(chunk);
+				std::vector< char > copy(data.begin(), data.end());
+				plain.add(magic, copy);
+				uint32_t stride = (copy.size() % 4 == 0 ? 4 : 1);
+				if (magic == "pnct" && copy.size() % 36 == 0) stride = 36; //MeshBuffer::Vertex
+				if (magic == "qnct" && copy.size() % 20 == 0) stride = 20; //MeshBuffer::QuantizedVertex
+				compressed.add_compressed(magic, copy, stride);
+				raw_total += copy.size();
+			}
+			for (auto const &[name, writer] : {std::make_pair(plain_filename, &plain), std::make_pair(compressed_filename, &compressed)}) {
+				std::ofstream out(name, std::ios::binary);
+				writer->write(&out);
+				if (!out) throw std::runtime_error("Failed to write '" + name + "'");
+			}
+		} catch (std::exception &e) {
+			std::cerr << filename << ": " << e.what() << std::endl;
+			return 1;
+		}
+
+		auto file_size = [](std::string const &name) {
+			std::ifstream in(name, std::ios::binary | std::ios::ate);
+			return size_t(in.tellg());
+		};
+		size_t plain_size = file_size(plain_filename);
+		size_t compressed_size = file_size(compressed_filename);
+
+		if (load(plain_filename) != load(compressed_filename)) {
+			std::cerr << filename << ": compressed copy doesn't read back the same!" << std::endl;
+			return 1;
+		}
+
+		//fastest of 'repeats' loads (evicting the file first for cold loads):
+		bool can_evict = true;
+		auto time_load = [&](std::string const &name, bool cold) {
+			double best = 1e30;
+			for (uint32_t r = 0; r < repeats; ++r) {
+				if (cold) can_evict = evict(name) && can_evict;
+				auto before = std::chrono::high_resolution_clock::now();
+				load(name);
+				best = std::min(best, seconds_since(before));
+			}
+			return best;
+		};
+		double warm_plain = time_load(plain_filename, false);
+		double warm_compressed = time_load(compressed_filename, false);
+		double cold_plain = time_load(plain_filename, true);
+		double cold_compressed = time_load(compressed_filename, true);
+
+		//decompression alone (file already mapped and in cache):
+		double serial = 1e30, parallel = 1e30;
+		size_t decompressed = 0;
+		for (uint32_t r = 0; r < repeats; ++r) {
+			{
+				ChunkFile file(compressed_filename);
+				auto before = std::chrono::high_resolution_clock::now();
+				for (ChunkFile::Chunk &chunk : file.chunks) file.view< char >(chunk); //(decompresses on first view)
+				serial = std::min(serial, seconds_since(before));
+				decompressed = file.decompressed_bytes;
+			}
+			{
+				ChunkFile file(compressed_filename);
+				auto before = std::chrono::high_resolution_clock::now();
+				file.decompress_all();
+				parallel = std::min(parallel, seconds_since(before));
+			}
+		}
+
+		std::remove(plain_filename.c_str());
+		std::remove(compressed_filename.c_str());
+
+		std::cout << filename << ": " << raw_total << " bytes of chunks; "
+			<< plain_size << " bytes plain -> " << compressed_size << " bytes compressed ("
+			<< 100.0 * double(compressed_size) / double(plain_size) << "%)\n";
+		std::cout << "  warm load: " << warm_plain * 1e3 << " ms plain, " << warm_compressed * 1e3 << " ms compressed\n";
+		if (can_evict) {
+			std::cout << "  cold load: " << cold_plain * 1e3 << " ms plain, " << cold_compressed * 1e3 << " ms compressed\n";
+		} else {
+			std::cout << "  cold load: n/a (can't drop files from the page cache here)\n";
+		}
+		if (decompressed) {
+			std::cout << "  decompression: " << decompressed / serial * 1e-6 << " MB/s one chunk at a time, "
+				<< decompressed / parallel * 1e-6 << " MB/s with decompress_all" << std::endl;
+		} else {
+			std::cout << "  decompression: no chunk was worth compressing" << std::endl;
+		}
+	}
+
+	return 0;
+}
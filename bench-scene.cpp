@@ -0,0 +1,125 @@
+//Microbenchmark for Scene copies (Scene::set)
+//Usage:
+//  bench-scene [transforms] [copies]
+//Compares Scene::set against the old pointer-map-based copy, and checks that both produce the same hierarchy.
+
+#include "Scene.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//scene copy as done before Scene::set used slot indices (hash lookup per pointer), for comparison:
+static void map_copy(Scene &scene, Scene const &other) {
+	std::unordered_map< Scene::Transform const *, Scene::Transform * > transform_to_transform;
+	transform_to_transform.insert(std::make_pair(nullptr, nullptr));
+
+	scene.transforms.clear();
+	for (auto const &t : other.transforms) {
+		scene.transforms.emplace_back();
+		Scene::Transform &n = scene.transforms.back();
+		n.name = t.name;
+		n.position = t.position;
+		n.rotation = t.rotation;
+		n.scale = t.scale;
+		n.parent = transform_to_transform.at(t.parent); //(benchmark scene is in parents-first order)
+		transform_to_transform.insert(std::make_pair(&t, &n));
+	}
+
+	scene.drawables = other.drawables;
+	for (auto &d : scene.drawables) d.transform = transform_to_transform.at(d.transform);
+	scene.cameras = other.cameras;
+	for (auto &c : scene.cameras) c.transform = transform_to_transform.at(c.transform);
+	scene.lights = other.lights;
+	for (auto &l : scene.lights) l.transform = transform_to_transform.at(l.transform);
+}
+
+//parent of each transform as an index (-1U for none), for checking copies:
+static std::vector< uint32_t > parent_indices(Scene const &scene) {
+	std::unordered_map< Scene::Transform const *, uint32_t > index;
+	for (auto const &t : scene.transforms) index.emplace(&t, uint32_t(index.size()));
+	std::vector< uint32_t > ret;
+	for (auto const &t : scene.transforms) ret.emplace_back(t.parent ? index.at(t.parent) : -1U);
+	for (auto const &d : scene.drawables) ret.emplace_back(index.at(d.transform));
+	return ret;
+}
+
+int main(int argc, char **argv) {
+	uint64_t count = 100000;
+	uint64_t copies = 20;
+	bool ok = (argc <= 3);
+	try {
+		if (ok && argc > 1) count = std::stoull(argv[1]);
+		if (ok && argc > 2) copies = std::stoull(argv[2]);
+	} catch (std::logic_error &) { //(invalid_argument or out_of_range)
+		ok = false;
+	}
+	if (!ok || count == 0 || count > 0xffffffff || copies == 0 || copies > 0xffffffff) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [transforms] [copies]" << std::endl;
+		return 1;
+	}
+
+	//build a scene with a random (parents-first) hierarchy; every other transform gets a drawable:
+	Scene scene;
+	{
+		std::mt19937 gen(0x5eed);
+		std::uniform_real_distribution< float > pos(-10.0f, 10.0f);
+		std::vector< Scene::Transform * > made;
+		made.reserve(count);
+		for (uint32_t i = 0; i < count; ++i) {
+			scene.transforms.emplace_back();
+			Scene::Transform &t = scene.transforms.back();
+			t.name = "Transform" + std::to_string(i);
+			t.position = glm::vec3(pos(gen), pos(gen), pos(gen));
+			if (i > 0 && gen() % 4 != 0) t.parent = made[gen() % i];
+			made.emplace_back(&t);
+			if (i % 2 == 0) scene.drawables.emplace_back(&t);
+		}
+		scene.cameras.emplace_back(made[0]);
+		scene.lights.emplace_back(made[count / 2]);
+	}
+	std::vector< uint32_t > expected = parent_indices(scene);
+
+	auto run = [&](char const *label, auto &&copy) {
+		Scene target;
+		auto before = std::chrono::high_resolution_clock::now();
+		for (uint32_t c = 0; c < copies; ++c) {
+			copy(target);
+		}
+		auto after = std::chrono::high_resolution_clock::now();
+		double seconds = std::chrono::duration< double >(after - before).count();
+
+		if (parent_indices(target) != expected) {
+			std::cerr << "WARNING: " << label << " copy has a different hierarchy than the original." << std::endl;
+		}
+		std::cout << label << ": " << seconds * 1000.0 / copies << " ms/copy (" << count << " transforms)" << std::endl;
+	};
+
+	run("pointer map", [&](Scene &target) { map_copy(target, scene); });
+	run("Scene::set", [&](Scene &target) { target.set(scene); });
+
+	//Scene::set also carries over cached world matrices, so updating a fresh copy is nearly free:
+	scene.update_world_matrices();
+	{
+		Scene target;
+		target = scene;
+		auto before = std::chrono::high_resolution_clock::now();
+		target.update_world_matrices();
+		auto after = std::chrono::high_resolution_clock::now();
+		double copied = std::chrono::duration< double >(after - before).count();
+
+		map_copy(target, scene);
+		before = std::chrono::high_resolution_clock::now();
+		target.update_world_matrices();
+		after = std::chrono::high_resolution_clock::now();
+		double fresh = std::chrono::duration< double >(after - before).count();
+
+		std::cout << "first update_world_matrices after copy: " << copied * 1000.0 << " ms (with cache) vs " << fresh * 1000.0 << " ms (without)" << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,103 @@
+//Microbenchmark for the snow fall kernels in SnowFall.cpp
+//Usage:
+//  bench-snow [flakes] [frames]
+//Reports flakes/second for each kernel supported on this machine.
+
+#include "SnowFall.hpp"
+#include "Particles.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//step copies of 'initial' with 'kernel' and with the scalar kernel side by side (untimed),
+// comparing positions and masks after every frame; returns the first frame that differs (or 'frames' if none does):
+// (the kernels do the same float operations in the same order, so results should match exactly)
+static uint64_t first_difference(SnowFallParams const &params, Particles const &initial, uint64_t frames, SnowFallKernel kernel) {
+	size_t flakes = initial.size();
+	Particles snow = initial, reference = initial;
+	std::vector< uint8_t > captured((flakes + 7) / 8), grounded((flakes + 7) / 8);
+	std::vector< uint8_t > reference_captured((flakes + 7) / 8), reference_grounded((flakes + 7) / 8);
+	for (uint64_t f = 0; f < frames; ++f) {
+		snow_fall(params, flakes, snow.x.data(), snow.y.data(), snow.z.data(), snow.fall_speed.data(), captured.data(), grounded.data(), kernel);
+		snow_fall(params, flakes, reference.x.data(), reference.y.data(), reference.z.data(), reference.fall_speed.data(), reference_captured.data(), reference_grounded.data(), SnowFallScalar);
+		if (captured != reference_captured || grounded != reference_grounded) return f;
+		if (snow.x != reference.x || snow.y != reference.y || snow.z != reference.z) return f;
+	}
+	return frames;
+}
+
+int main(int argc, char **argv) {
+	uint64_t flakes = 100000;
+	uint64_t frames = 1000;
+	bool ok = (argc <= 3);
+	try {
+		if (ok && argc > 1) flakes = std::stoull(argv[1]);
+		if (ok && argc > 2) frames = std::stoull(argv[2]);
+	} catch (std::logic_error &) { //(invalid_argument or out_of_range)
+		ok = false;
+	}
+	if (!ok || flakes == 0 || flakes > 0xffffffff || frames == 0 || frames > 0xffffffff) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [flakes] [frames]" << std::endl;
+		return 1;
+	}
+
+	//same sort of setup as PlayMode:
+	SnowFallParams params;
+	params.elapsed = 1.0f / 60.0f;
+	params.center = glm::vec3(3.0f, -2.0f, 4.2f);
+	params.radius = 5.6f;
+	params.ground = -1.0f;
+
+	Particles initial;
+	initial.resize(flakes);
+	std::mt19937 gen(0x5eed);
+	std::uniform_real_distribution< float > xy(-45.0f, 45.0f);
+	std::uniform_real_distribution< float > alt(0.0f, 110.0f);
+	std::uniform_real_distribution< float > speed(7.0f, 13.0f);
+	for (size_t i = 0; i < flakes; ++i) {
+		initial.x[i] = xy(gen);
+		initial.y[i] = xy(gen);
+		initial.z[i] = alt(gen);
+		initial.fall_speed[i] = speed(gen);
+	}
+
+	for (uint32_t k = 0; k < SnowFallKernelCount; ++k) {
+		SnowFallKernel kernel = SnowFallKernel(k);
+		if (!snow_fall_kernel_supported(kernel)) {
+			std::cout << snow_fall_kernel_name(kernel) << ": not supported" << std::endl;
+			continue;
+		}
+
+		Particles snow = initial;
+		std::vector< uint8_t > captured((flakes + 7) / 8), grounded((flakes + 7) / 8);
+		uint64_t hits = 0;
+
+		auto before = std::chrono::high_resolution_clock::now();
+		for (uint32_t f = 0; f < frames; ++f) {
+			snow_fall(params, flakes, snow.x.data(), snow.y.data(), snow.z.data(), snow.fall_speed.data(), captured.data(), grounded.data(), kernel);
+			//consume the masks so the work can't be skipped:
+			hits += captured[f % captured.size()] + grounded[f % grounded.size()];
+		}
+		auto after = std::chrono::high_resolution_clock::now();
+		double seconds = std::chrono::duration< double >(after - before).count();
+
+		//check against the scalar kernel's results:
+		if (kernel != SnowFallScalar) {
+			uint64_t differs = first_difference(params, initial, frames, kernel);
+			if (differs != frames) {
+				std::cerr << "WARNING: " << snow_fall_kernel_name(kernel) << " results differ from scalar kernel (at frame " << differs << ")." << std::endl;
+			}
+		}
+
+		std::cout << snow_fall_kernel_name(kernel) << ": "
+			<< (double(flakes) * frames / seconds) / 1.0e6 << " M flakes/second"
+			<< " (" << seconds * 1000.0 / frames << " ms/frame for " << flakes << " flakes; checksum " << hits << ")"
+			<< std::endl;
+	}
+
+	return 0;
+}
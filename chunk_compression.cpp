@@ -0,0 +1,300 @@
+#include "chunk_compression.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+//-------------------------
+//LZ4 block format: a series of sequences, each
+//  token (high nibble: literal count, low nibble: match length - 4; 15 means "more length bytes follow")
+//  [literal length bytes] literals [match offset (2 bytes, little-endian) [match length bytes]]
+//The last sequence has only literals. Matches can't start in the last 12 bytes, and the last 5 bytes are always literals.
+
+namespace {
+
+constexpr size_t MinMatch = 4;
+constexpr size_t LastLiterals = 5;
+constexpr size_t MatchFindLimit = 12;
+constexpr uint32_t HashBits = 16;
+constexpr size_t MaxOffset = 65535;
+
+uint32_t read32(char const *at) {
+	uint32_t ret;
+	std::memcpy(&ret, at, 4);
+	return ret;
+}
+
+uint32_t hash4(uint32_t sequence) {
+	return (sequence * 2654435761u) >> (32 - HashBits);
+}
+
+void put_length(std::vector< char > &out, size_t length) {
+	//(the first 15 went in the token)
+	while (length >= 255) {
+		out.emplace_back(char(255));
+		length -= 255;
+	}
+	out.emplace_back(char(length));
+}
+
+void put_sequence(std::vector< char > &out, char const *literals, size_t literal_count, size_t offset, size_t match_length) {
+	size_t match_code = (match_length ? match_length - MinMatch : 0);
+	uint8_t token = uint8_t((std::min< size_t >(literal_count, 15) << 4) | std::min< size_t >(match_code, 15));
+	out.emplace_back(char(token));
+	if (literal_count >= 15) put_length(out, literal_count - 15);
+	out.insert(out.end(), literals, literals + literal_count);
+	if (match_length) {
+		out.emplace_back(char(offset & 0xff));
+		out.emplace_back(char(offset >> 8));
+		if (match_code >= 15) put_length(out, match_code - 15);
+	}
+}
+
+} //namespace
+
+std::vector< char > lz4_compress(char const *data, size_t size) {
+	std::vector< char > out;
+	out.reserve(size + size / 255 + 16);
+
+	char const *anchor = data; //start of pending literals
+	if (size > MatchFindLimit) {
+		std::vector< uint32_t > table(size_t(1) << HashBits, uint32_t(-1)); //last position of each 4-byte hash
+		char const *match_limit = data + size - MatchFindLimit; //(matches start before here)
+		char const *end_limit = data + size - LastLiterals; //(matches end before here)
+
+		char const *ip = data;
+		while (ip < match_limit) {
+			uint32_t sequence = read32(ip);
+			uint32_t &slot = table[hash4(sequence)];
+			uint32_t candidate = slot;
+			slot = uint32_t(ip - data);
+
+			if (candidate == uint32_t(-1) || size_t(ip - data) - candidate > MaxOffset || read32(data + candidate) != sequence) {
+				++ip;
+				continue;
+			}
+
+			//found a match; extend it backward over pending literals and forward as far as allowed:
+			char const *match = data + candidate;
+			while (ip > anchor && match > data && ip[-1] == match[-1]) {
+				--ip;
+				--match;
+			}
+			char const *match_end = ip + MinMatch;
+			char const *from = match + MinMatch;
+			while (match_end < end_limit && *match_end == *from) {
+				++match_end;
+				++from;
+			}
+
+			put_sequence(out, anchor, size_t(ip - anchor), size_t(ip - match), size_t(match_end - ip));
+
+			//hash a position inside the match too, so nearby repeats are found:
+			if (match_end - 2 > data) table[hash4(read32(match_end - 2))] = uint32_t(match_end - 2 - data);
+			ip = anchor = match_end;
+		}
+	}
+
+	//trailing literals:
+	put_sequence(out, anchor, size_t(data + size - anchor), 0, 0);
+	return out;
+}
+
+bool lz4_decompress(char const *src, size_t src_size, char *dst, size_t dst_size) {
+	uint8_t const *ip = reinterpret_cast< uint8_t const * >(src);
+	uint8_t const *iend = ip + src_size;
+	char *op = dst;
+	char *oend = dst + dst_size;
+
+	//read an extended length; returns false on overrun:
+	auto get_length = [&](size_t *length) {
+		uint8_t b;
+		do {
+			if (ip == iend) return false;
+			b = *ip++;
+			*length += b;
+		} while (b == 255);
+		return true;
+	};
+
+	while (true) {
+		if (ip == iend) return false;
+		uint8_t token = *ip++;
+
+		size_t literal_count = token >> 4;
+		if (literal_count == 15 && !get_length(&literal_count)) return false;
+		if (literal_count > size_t(iend - ip) || literal_count > size_t(oend - op)) return false;
+		if (literal_count <= 16 && iend - ip >= 16 && oend - op >= 16) {
+			std::memcpy(op, ip, 16); //(fixed-size copy is much faster; bytes past the literals get overwritten later)
+		} else if (literal_count) {
+			std::memcpy(op, ip, literal_count);
+		}
+		op += literal_count;
+		ip += literal_count;
+
+		if (ip == iend) return op == oend; //(last sequence has no match)
+
+		if (iend - ip < 2) return false;
+		size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+		ip += 2;
+		if (offset == 0 || offset > size_t(op - dst)) return false;
+
+		size_t match_length = token & 0xf;
+		if (match_length == 15 && !get_length(&match_length)) return false;
+		match_length += MinMatch;
+		if (match_length > size_t(oend - op)) return false;
+
+		char const *match = op - offset;
+		if (match_length <= 16 && offset >= 16 && oend - op >= 16) {
+			std::memcpy(op, match, 16); //(as above)
+			op += match_length;
+		} else if (offset >= match_length) {
+			std::memcpy(op, match, match_length);
+			op += match_length;
+		} else {
+			//overlapping (repeating pattern): copy whole periods from the start of the match, doubling each time:
+			// (pieces never overlap, and the output stays a repeat of the first 'offset' bytes)
+			while (match_length) {
+				size_t n = std::min(size_t(op - match), match_length);
+				std::memcpy(op, match, n);
+				op += n;
+				match_length -= n;
+			}
+		}
+	}
+}
+
+//-------------------------
+
+namespace {
+
+//split elements into byte planes (byte 0 of each element, then byte 1, ...), optionally storing each byte
+// as the difference from the byte before it in its plane:
+void shuffle(char const *in, size_t size, uint32_t stride, bool delta, char *out) {
+	size_t count = size / stride;
+	for (uint32_t b = 0; b < stride; ++b) {
+		char *plane = out + b * count;
+		uint8_t prev = 0;
+		for (size_t i = 0; i < count; ++i) {
+			uint8_t value = uint8_t(in[i * stride + b]);
+			plane[i] = char(delta ? uint8_t(value - prev) : value);
+			prev = value;
+		}
+	}
+	if (size % stride) std::memcpy(out + count * stride, in + count * stride, size % stride); //(partial element at the end)
+}
+
+//inverse of shuffle; with the stride known at compile time, each element's bytes are gathered in one pass:
+template< uint32_t Stride >
+void unshuffle_fixed(char const *in, size_t count, bool delta, char *out) {
+	uint8_t prev[Stride] = {};
+	for (size_t i = 0; i < count; ++i) {
+		for (uint32_t b = 0; b < Stride; ++b) {
+			uint8_t value = uint8_t(in[b * count + i]);
+			if (delta) value = uint8_t(value + prev[b]);
+			prev[b] = value;
+			out[i * Stride + b] = char(value);
+		}
+	}
+}
+
+void unshuffle(char const *in, size_t size, uint32_t stride, bool delta, char *out) {
+	size_t count = size / stride;
+	if (stride == 2) unshuffle_fixed< 2 >(in, count, delta, out);
+	else if (stride == 4) unshuffle_fixed< 4 >(in, count, delta, out);
+	else if (stride == 8) unshuffle_fixed< 8 >(in, count, delta, out);
+	else {
+		//(element by element, so writes are sequential; the reads are 'stride' sequential streams)
+		std::vector< uint8_t > prev(stride, 0);
+		for (size_t i = 0; i < count; ++i) {
+			char *element = out + i * stride;
+			for (uint32_t b = 0; b < stride; ++b) {
+				uint8_t value = uint8_t(in[b * count + i]);
+				if (delta) value = uint8_t(value + prev[b]);
+				prev[b] = value;
+				element[b] = char(value);
+			}
+		}
+	}
+	if (size % stride) std::memcpy(out + count * stride, in + count * stride, size % stride);
+}
+
+std::vector< char > compress_filtered(char const *data, size_t size, ChunkFilter filter, uint32_t stride) {
+	std::vector< char > filtered;
+	char const *input = data;
+	if (filter != ChunkFilterNone) {
+		filtered.resize(size);
+		shuffle(data, size, stride, filter == ChunkFilterShuffleDelta, filtered.data());
+		input = filtered.data();
+	}
+
+	CompressedChunkHeader header;
+	header.raw_size = uint32_t(size);
+	header.filter = filter;
+	header.reserved = 0;
+	header.stride = uint16_t(filter == ChunkFilterNone ? 1 : stride);
+
+	std::vector< char > block = lz4_compress(input, size);
+	std::vector< char > out(sizeof(header) + block.size());
+	std::memcpy(out.data(), &header, sizeof(header));
+	std::memcpy(out.data() + sizeof(header), block.data(), block.size());
+	return out;
+}
+
+} //namespace
+
+std::vector< char > compress_chunk_payload(char const *data, size_t size, uint32_t stride) {
+	if (size > 0xffffffffu) throw std::runtime_error("Chunk too large to compress");
+	if (stride == 0 || stride > 0xffff) throw std::runtime_error("Bad stride for chunk compression");
+
+	std::vector< char > best = compress_filtered(data, size, ChunkFilterNone, 1);
+	auto consider = [&](ChunkFilter filter, uint32_t s) {
+		std::vector< char > attempt = compress_filtered(data, size, filter, s);
+		if (attempt.size() < best.size()) best.swap(attempt);
+	};
+	if (stride > 1) {
+		consider(ChunkFilterShuffle, stride);
+		consider(ChunkFilterShuffleDelta, stride);
+	}
+	//structs of floats (or other 4-byte fields) often do better shuffled as plain 4-byte values:
+	if (stride != 4 && stride % 4 == 0) {
+		consider(ChunkFilterShuffle, 4);
+		consider(ChunkFilterShuffleDelta, 4);
+	}
+	return best;
+}
+
+size_t compressed_chunk_raw_size(char const *payload, size_t payload_size) {
+	if (payload_size < sizeof(CompressedChunkHeader)) {
+		throw std::runtime_error("Compressed chunk is too small to have a header");
+	}
+	CompressedChunkHeader header;
+	std::memcpy(&header, payload, sizeof(header));
+	return header.raw_size;
+}
+
+void decompress_chunk_payload(char const *payload, size_t payload_size, char *out) {
+	CompressedChunkHeader header;
+	if (payload_size < sizeof(header)) {
+		throw std::runtime_error("Compressed chunk is too small to have a header");
+	}
+	std::memcpy(&header, payload, sizeof(header));
+	if (header.filter > ChunkFilterShuffleDelta || header.stride == 0) {
+		throw std::runtime_error("Compressed chunk has an unknown filter");
+	}
+
+	char const *block = payload + sizeof(header);
+	size_t block_size = payload_size - sizeof(header);
+	if (header.filter == ChunkFilterNone) {
+		if (!lz4_decompress(block, block_size, out, header.raw_size)) {
+			throw std::runtime_error("Compressed chunk data is malformed");
+		}
+	} else {
+		std::unique_ptr< char[] > filtered(new char[header.raw_size]); //(no need to zero-fill)
+		if (!lz4_decompress(block, block_size, filtered.get(), header.raw_size)) {
+			throw std::runtime_error("Compressed chunk data is malformed");
+		}
+		unshuffle(filtered.get(), header.raw_size, header.stride, header.filter == ChunkFilterShuffleDelta, out);
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+/*
+ * Compression for chunk payloads (see read_write_chunk.hpp and ChunkFile).
+ *
+ * A compressed chunk has the high bit of its first magic byte set and a
+ *  payload of a CompressedChunkHeader followed by an LZ4 block
+ *  (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md) --
+ *  byte-oriented, so decoding is mostly memcpy and runs at several GB/s.
+ *
+ * Before compressing, a filter may rearrange the bytes to expose more
+ *  repetition in arrays of floats / structs:
+ *  - shuffle: with elements of 'stride' bytes, store byte 0 of every element,
+ *    then byte 1 of every element, etc. (exponent bytes of nearby floats
+ *    tend to match; mantissa bytes don't, and now they don't interrupt matches)
+ *  - delta: (after shuffling) store each byte minus the one before it in the
+ *    same byte plane, so slowly-changing bytes become runs of near-zero values
+ *
+ * Each chunk compresses on its own, so chunks can be decompressed in parallel
+ *  (see ChunkFile::decompress_all).
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//set in magic[0] of a compressed chunk (magic numbers are otherwise ASCII):
+constexpr uint8_t CompressedChunkFlag = 0x80;
+
+enum ChunkFilter : uint8_t {
+	ChunkFilterNone = 0,
+	ChunkFilterShuffle = 1,
+	ChunkFilterShuffleDelta = 2,
+};
+
+struct CompressedChunkHeader {
+	uint32_t raw_size; //payload size after decompression
+	uint8_t filter; //a ChunkFilter
+	uint8_t reserved;
+	uint16_t stride; //element size for the shuffle filter
+};
+static_assert(sizeof(CompressedChunkHeader) == 8, "CompressedChunkHeader is packed.");
+
+//compress 'size' bytes of elements 'stride' bytes apart into a CompressedChunkHeader + LZ4 block,
+// trying a few filters and keeping whichever compresses best:
+std::vector< char > compress_chunk_payload(char const *data, size_t size, uint32_t stride);
+
+//raw size of a compressed payload (throws if payload is too small to have a header):
+size_t compressed_chunk_raw_size(char const *payload, size_t payload_size);
+
+//decompress a payload made by compress_chunk_payload into 'out', which must hold compressed_chunk_raw_size() bytes:
+// (throws std::runtime_error on malformed data; never writes outside 'out')
+void decompress_chunk_payload(char const *payload, size_t payload_size, char *out);
+
+//the underlying LZ4 block codec:
+std::vector< char > lz4_compress(char const *data, size_t size);
+//returns false if 'src' is malformed or doesn't decode to exactly dst_size bytes:
+bool lz4_decompress(char const *src, size_t src_size, char *dst, size_t dst_size);
@@ -0,0 +1,232 @@
+//Converts a triangle-soup .pnct file (as written by scenes/export-meshes.py) into an indexed one:
+//Usage:
+//  index-meshes [--quantize] [--compress] <in.pnct> <out.pnct>
+//Each mesh's vertices are welded (after snapping normals to a 1/1024 grid), its triangles reordered for the post-transform vertex cache,
+// and its vertices renumbered in order of first use (see MeshOptimize.hpp).
+//The output has the same chunks as the input plus an 'idx1' element chunk;
+// its 'idx0' entries then give ranges of elements instead of vertices. MeshBuffer reads both kinds.
+//The output also starts with a 'toc0' chunk (see ChunkTocWriter in read_write_chunk.hpp), so readers can skip to the chunks they need.
+//(in == out is fine; indexed input is expanded back to soup and re-indexed)
+//With --quantize, vertices are written in MeshBuffer's compact QuantizedVertex layout instead:
+// the output then has a 'qnct' chunk in place of 'pnct' and ends with a 'box0' chunk of per-mesh bounding boxes.
+// (quantization happens before welding, so vertices that quantize identically are shared)
+//With --compress, the vertex and element chunks are stored compressed (see chunk_compression.hpp) when that makes them smaller.
+
+#include "MeshOptimize.hpp"
+#include "ChunkFile.hpp"
+#include "read_write_chunk.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+//same layout as MeshBuffer's vertices:
+struct Vertex {
+	glm::vec3 Position;
+	glm::vec3 Normal;
+	glm::u8vec4 Color;
+	glm::vec2 TexCoord;
+};
+static_assert(sizeof(Vertex) == 3*4+3*4+4*1+2*4, "Vertex is packed.");
+
+//same layout as MeshBuffer::QuantizedVertex:
+struct QuantizedVertex {
+	glm::i16vec4 Position;
+	glm::i16vec2 Normal;
+	glm::u8vec4 Color;
+	uint16_t TexCoord[2];
+};
+static_assert(sizeof(QuantizedVertex) == 4*2+2*2+4*1+2*2, "QuantizedVertex is packed.");
+
+struct IndexEntry {
+	uint32_t name_begin, name_end;
+	uint32_t vertex_begin, vertex_end;
+};
+static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
+
+struct BoxEntry {
+	glm::vec3 min, max;
+};
+static_assert(sizeof(BoxEntry) == 24, "Box entry should be packed");
+
+constexpr float NormalGrid = 1024.0f; //normals are snapped to multiples of 1 / NormalGrid before welding
+
+//pack a vertex, with position relative to 'box':
+static QuantizedVertex quantize(Vertex const &v, BoxEntry const &box) {
+	glm::vec3 scale = 0.5f * (box.max - box.min);
+	glm::vec3 offset = 0.5f * (box.max + box.min);
+	QuantizedVertex q;
+	for (uint32_t c = 0; c < 3; ++c) {
+		q.Position[c] = (scale[c] > 0.0f ? quantize_snorm16((v.Position[c] - offset[c]) / scale[c]) : 0);
+	}
+	q.Position.w = 0;
+	float octahedral[2];
+	encode_octahedral(&v.Normal.x, octahedral);
+	q.Normal.x = quantize_snorm16(octahedral[0]);
+	q.Normal.y = quantize_snorm16(octahedral[1]);
+	q.Color = v.Color;
+	q.TexCoord[0] = float_to_half(v.TexCoord.x);
+	q.TexCoord[1] = float_to_half(v.TexCoord.y);
+	return q;
+}
+
+//weld + reorder one mesh's soup vertices, appending the results to out_data / out_elements:
+template< typename V >
+static void index_mesh(std::vector< V > const &soup, std::vector< V > *out_data_, std::vector< uint32_t > *out_elements_, float *acmr_before, float *acmr_after) {
+	auto &out_data = *out_data_;
+	auto &out_elements = *out_elements_;
+	uint32_t count = uint32_t(soup.size());
+
+	//weld:
+	std::vector< uint32_t > indices = weld_vertices(soup.data(), count, sizeof(V));
+	uint32_t unique = 0;
+	for (uint32_t i : indices) unique = std::max(unique, i + 1);
+	std::vector< V > vertices(unique);
+	for (uint32_t v = 0; v < count; ++v) {
+		vertices[indices[v]] = soup[v];
+	}
+	*acmr_before += vertex_cache_acmr(indices.data(), indices.size()) * (count / 3);
+
+	//reorder triangles, then vertices:
+	optimize_vertex_cache(indices.data(), indices.size(), vertices.size());
+	std::vector< uint32_t > remap = optimize_vertex_fetch(indices.data(), indices.size(), vertices.size());
+	*acmr_after += vertex_cache_acmr(indices.data(), indices.size()) * (count / 3);
+
+	//append:
+	uint32_t base = uint32_t(out_data.size());
+	out_data.resize(base + unique);
+	for (uint32_t v = 0; v < unique; ++v) {
+		out_data[base + remap[v]] = vertices[v];
+	}
+	for (uint32_t i : indices) out_elements.emplace_back(base + i);
+}
+
+int main(int argc, char **argv) {
+	bool quantize_vertices = false;
+	bool compress_chunks = false;
+	int arg = 1;
+	for (; arg < argc && std::string(argv[arg]).substr(0, 2) == "--"; ++arg) {
+		std::string flag = argv[arg];
+		if (flag == "--quantize") quantize_vertices = true;
+		else if (flag == "--compress") compress_chunks = true;
+		else break;
+	}
+	if (argc - arg != 2) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--quantize] [--compress] <in.pnct> <out.pnct>" << std::endl;
+		return 1;
+	}
+	std::string in_filename = argv[argc-2];
+	std::string out_filename = argv[argc-1];
+
+	std::vector< Vertex > data;
+	std::vector< uint32_t > elements;
+	std::vector< char > strings;
+	std::vector< IndexEntry > index;
+	{ //read input (copying it, since the file is unmapped before output is written):
+		ChunkFile file(in_filename);
+		if (file.has("qnct")) {
+			std::cerr << "'" << in_filename << "' is already quantized; run on the original (float) mesh file instead." << std::endl;
+			return 1;
+		}
+		auto copy = [](auto const &span) {
+			return std::vector< typename std::decay< decltype(span[0]) >::type >(span.begin(), span.end());
+		};
+		data = copy(file.find< Vertex >("pnct"));
+		if (file.has("idx1")) elements = copy(file.find< uint32_t >("idx1"));
+		strings = copy(file.find< char >("str0"));
+		index = copy(file.find< IndexEntry >("idx0"));
+		if (file.trailing_bytes) {
+			std::cerr << "WARNING: trailing data in mesh file '" << in_filename << "'" << std::endl;
+		}
+	}
+
+	//expand already-indexed input back to soup:
+	if (!elements.empty()) {
+		std::vector< Vertex > soup;
+		soup.reserve(elements.size());
+		for (uint32_t e : elements) {
+			if (e >= data.size()) throw std::runtime_error("element chunk has out-of-range vertex index");
+			soup.emplace_back(data[e]);
+		}
+		data.swap(soup);
+	}
+
+	//snap normals to a fine grid, so that faces exported with nearly-equal normals (e.g., flat-shaded
+	// coplanar triangles) can share vertices; the change is far below what shading can show:
+	for (Vertex &v : data) {
+		v.Normal = glm::round(v.Normal * NormalGrid) / NormalGrid;
+	}
+
+	std::vector< Vertex > out_data;
+	std::vector< QuantizedVertex > out_quantized_data; //(used instead of out_data with --quantize)
+	std::vector< uint32_t > out_elements;
+	std::vector< IndexEntry > out_index;
+	std::vector< BoxEntry > out_boxes;
+	float acmr_before = 0.0f, acmr_after = 0.0f; //(weighted by triangle count)
+	for (IndexEntry const &entry : index) {
+		if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= data.size())) {
+			throw std::runtime_error("index entry has out-of-range vertex start/count");
+		}
+		uint32_t count = entry.vertex_end - entry.vertex_begin;
+		if (count % 3 != 0) throw std::runtime_error("mesh vertex count is not a multiple of three");
+		std::vector< Vertex > soup(data.begin() + entry.vertex_begin, data.begin() + entry.vertex_end);
+
+		IndexEntry out_entry = entry;
+		out_entry.vertex_begin = uint32_t(out_elements.size());
+		if (quantize_vertices) {
+			BoxEntry box{glm::vec3(0.0f), glm::vec3(0.0f)}; //(empty meshes get an empty-but-finite box)
+			if (!soup.empty()) {
+				box.min = box.max = soup[0].Position;
+				for (Vertex const &v : soup) {
+					box.min = glm::min(box.min, v.Position);
+					box.max = glm::max(box.max, v.Position);
+				}
+			}
+			out_boxes.emplace_back(box);
+
+			std::vector< QuantizedVertex > quantized_soup;
+			quantized_soup.reserve(soup.size());
+			for (Vertex const &v : soup) quantized_soup.emplace_back(quantize(v, box));
+			index_mesh(quantized_soup, &out_quantized_data, &out_elements, &acmr_before, &acmr_after);
+		} else {
+			index_mesh(soup, &out_data, &out_elements, &acmr_before, &acmr_after);
+		}
+		out_entry.vertex_end = uint32_t(out_elements.size());
+		out_index.emplace_back(out_entry);
+	}
+
+	{ //write output:
+		ChunkTocWriter chunks;
+		auto add_big = [&](std::string const &magic, auto const &from) {
+			if (compress_chunks) chunks.add_compressed(magic, from);
+			else chunks.add(magic, from);
+		};
+		if (quantize_vertices) add_big("qnct", out_quantized_data);
+		else add_big("pnct", out_data);
+		add_big("idx1", out_elements);
+		chunks.add("str0", strings);
+		chunks.add("idx0", out_index);
+		if (quantize_vertices) chunks.add("box0", out_boxes);
+
+		std::ofstream file(out_filename, std::ios::binary);
+		chunks.write(&file);
+		if (!file) {
+			std::cerr << "Failed to write '" << out_filename << "'" << std::endl;
+			return 1;
+		}
+	}
+
+	float triangles = float(std::max< size_t >(1, data.size() / 3));
+	std::cout << "Wrote '" << out_filename << "': " << index.size() << " meshes; "
+		<< data.size() << " soup vertices -> " << (quantize_vertices ? out_quantized_data.size() : out_data.size())
+		<< (quantize_vertices ? " quantized" : "") << " vertices + " << out_elements.size() << " elements; "
+		<< "ACMR (16-entry FIFO) " << acmr_before / triangles << " after welding -> " << acmr_after / triangles << " after reordering." << std::endl;
+
+	return 0;
+}
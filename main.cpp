@@ -12,22 +12,136 @@
 #include "gl_errors.hpp"
 
 //for screenshots:
-#include "load_save_png.hpp"
+#include "FrameCapture.hpp"
+
+//for the frame time overlay:
+#include "FrameProfiler.hpp"
+
+//for tracing:
+#include "Trace.hpp"
+
+//for running without a window:
+#include "HeadlessContext.hpp"
+
+//for seeding:
+#include "Random.hpp"
+
+//for recording and replaying input:
+#include "InputRecording.hpp"
 
 //Includes for libSDL:
 #include <SDL.h>
 
 //...and for c++ standard library functions:
+#include <cctype>
 #include <chrono>
 #include <iostream>
 #include <stdexcept>
 #include <memory>
 #include <algorithm>
+#include <numeric>
+#include <vector>
+
+//read a whole command-line argument as an unsigned number (false if it isn't one):
+static bool parse_number(char const *arg, uint64_t *value) {
+	std::string str = arg;
+	if (str.empty() || !std::isdigit(uint8_t(str[0]))) return false; //(stoull would skip whitespace and accept a sign)
+	try {
+		size_t used = 0;
+		*value = std::stoull(str, &used);
+		return used == str.size();
+	} catch (std::logic_error &) { //(invalid_argument or out_of_range)
+		return false;
+	}
+}
+
+//input to record or replay (from the command line; see InputRecording.hpp):
+static std::string record_filename;
+static std::unique_ptr< InputRecording > replay;
+
+//make the PlayMode, recording or replaying its input as asked:
+static std::shared_ptr< PlayMode > make_play_mode() {
+	auto play = std::make_shared< PlayMode >();
+	if (!record_filename.empty()) play->start_recording(record_filename);
+	if (replay) play->start_replay(*replay);
+	return play;
+}
+
+//run PlayMode for 'frames' frames without a window (see HeadlessContext.hpp), and report how long they took:
+// (if 'screenshot' isn't empty, the last frame is saved there)
+static int headless_main(uint32_t frames, std::string const &screenshot) {
+	HeadlessContext headless(glm::uvec2(960, 540)); //(same size as the window)
+	startup_mark("HeadlessContext");
+	std::cout << "Rendering headless with " << headless.renderer << "." << std::endl;
+
+	FrameCapture capture;
+	capture.framebuffer = headless.framebuffer;
+
+	call_load_functions();
+
+	Mode::set_current(make_play_mode());
+	startup_mark("PlayMode constructed");
+
+	//every frame gets the same elapsed time, so runs are comparable:
+	constexpr float Elapsed = 1.0f / 60.0f;
+	std::vector< float > frame_ms;
+	frame_ms.reserve(frames);
+	for (uint32_t frame = 0; frame < frames && Mode::current; ++frame) {
+		frame_profiler.begin_frame();
+		auto before = std::chrono::high_resolution_clock::now();
+		{
+			FrameProfiler::CpuScope profile(FrameProfiler::CpuUpdate);
+			Mode::current->update(Elapsed);
+			if (!Mode::current) break;
+		}
+		{
+			FrameProfiler::CpuScope profile(FrameProfiler::CpuDraw);
+			Mode::current->draw(headless.size);
+		}
+		{ //there is no swap, so wait for the frame to finish drawing instead:
+			FrameProfiler::CpuScope profile(FrameProfiler::CpuSwap);
+			TraceScope trace("glFinish");
+			glFinish();
+		}
+		auto after = std::chrono::high_resolution_clock::now();
+		frame_ms.emplace_back(std::chrono::duration< float, std::milli >(after - before).count());
+
+		if (frame + 1 == frames && !screenshot.empty()) {
+			capture.screenshot(screenshot);
+			capture.capture(headless.size); //(after the timed part of the frame)
+		}
+
+		if (frame == 0) {
+			startup_mark("first frame");
+			startup_report(); //(only if STARTUP_PROFILE is set)
+		}
+	}
+	Mode::set_current(nullptr);
+	capture.finish();
+
+	if (!frame_ms.empty()) {
+		std::vector< float > sorted = frame_ms;
+		std::sort(sorted.begin(), sorted.end());
+		auto percentile = [&sorted](float p) {
+			return sorted[std::min(sorted.size() - 1, size_t(p * float(sorted.size())))];
+		};
+		float total = std::accumulate(frame_ms.begin(), frame_ms.end(), 0.0f);
+		std::cout << "Ran " << frame_ms.size() << " frames in " << (total / 1000.0f) << " s"
+			<< " (" << (1000.0f * float(frame_ms.size()) / total) << " frames/s)." << std::endl;
+		std::cout << "Frame ms: mean " << (total / float(frame_ms.size()))
+			<< ", p50 " << percentile(0.50f) << ", p95 " << percentile(0.95f) << ", p99 " << percentile(0.99f)
+			<< ", max " << sorted.back() << std::endl;
+	}
+
+	trace_stop(); //(writes the trace, if tracing)
+	return 0;
+}
 
 #ifdef _WIN32
 extern "C" { uint32_t GetACP(); }
 #endif
 int main(int argc, char **argv) {
+	startup_mark("main"); //(startup report times are from here; see Load.hpp)
 #ifdef _WIN32
 	{ //when compiled on windows, check that code page is forced to utf-8 (makes file loading/saving work right):
 		//see: https://docs.microsoft.com/en-us/windows/apps/design/globalizing/use-utf8-code-page
@@ -43,6 +157,64 @@ int main(int argc, char **argv) {
 	try {
 #endif
 
+	//------------  command line ------------
+	uint32_t headless_frames = 0; //(if non-zero, run without a window for this many frames)
+	std::string headless_screenshot; //(where to save the last headless frame, if anywhere)
+	auto usage = [&]() {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--seed <seed>] [--trace <trace.json>] [--record <input.rec> | --replay <input.rec>] [--headless <frames> [--screenshot <last-frame.png>]]" << std::endl;
+		return 1;
+	};
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--seed" && argi + 1 < argc) {
+			uint64_t seed = 0;
+			if (!parse_number(argv[argi+1], &seed)) {
+				std::cerr << "Expecting a number for --seed, not '" << argv[argi+1] << "'." << std::endl;
+				return usage();
+			}
+			set_random_seed(seed);
+			argi += 1;
+		} else if (arg == "--trace" && argi + 1 < argc) {
+			trace_start(argv[argi+1]);
+			argi += 1;
+		} else if (arg == "--headless" && argi + 1 < argc) {
+			uint64_t frames = 0;
+			if (!parse_number(argv[argi+1], &frames) || frames == 0 || frames > 0xffffffff) {
+				std::cerr << "Expecting a positive number of frames for --headless, not '" << argv[argi+1] << "'." << std::endl;
+				return usage();
+			}
+			headless_frames = uint32_t(frames);
+			argi += 1;
+		} else if (arg == "--screenshot" && argi + 1 < argc) {
+			headless_screenshot = argv[argi+1];
+			argi += 1;
+		} else if (arg == "--record" && argi + 1 < argc) {
+			record_filename = argv[argi+1];
+			argi += 1;
+		} else if (arg == "--replay" && argi + 1 < argc) {
+			replay = std::make_unique< InputRecording >(InputRecording::load(argv[argi+1]));
+			argi += 1;
+		} else {
+			return usage();
+		}
+	}
+	if (replay) {
+		if (!record_filename.empty()) {
+			std::cerr << "Can't --record and --replay at the same time." << std::endl;
+			return 1;
+		}
+		//a recording only replays exactly with the seed it was recorded with:
+		set_random_seed(replay->header.seed);
+	}
+	std::cout << "Random seed is " << random_seed() << " (use '--seed " << random_seed() << "' to repeat this run)." << std::endl;
+
+	//with no display (e.g., to benchmark on a build machine), render offscreen instead:
+	if (headless_frames) return headless_main(headless_frames, headless_screenshot);
+	if (!headless_screenshot.empty()) {
+		std::cerr << "--screenshot only applies to --headless runs (press PRINTSCREEN instead)." << std::endl;
+		return 1;
+	}
+
 	//------------  initialization ------------
 
 	//Initialize SDL library:
@@ -82,6 +254,7 @@ int main(int argc, char **argv) {
 
 	//Create OpenGL context:
 	SDL_GLContext context = SDL_GL_CreateContext(window);
+	startup_mark("SDL_GL_CreateContext");
 
 	if (!context) {
 		SDL_DestroyWindow(window);
@@ -117,11 +290,15 @@ int main(int argc, char **argv) {
 	//Hide mouse cursor (note: showing can be useful for debugging):
 	//SDL_ShowCursor(SDL_DISABLE);
 
+	//Screenshots (and frame sequences) are read back and saved without stalling the game:
+	FrameCapture capture;
+
 	//------------ load assets --------------
 	call_load_functions();
 
 	//------------ create game mode + make current --------------
-	Mode::set_current(std::make_shared< PlayMode >());
+	Mode::set_current(make_play_mode());
+	startup_mark("PlayMode constructed");
 
 	//------------ main loop ------------
 
@@ -144,8 +321,10 @@ int main(int argc, char **argv) {
 	while (Mode::current) {
 		//every pass through the game loop creates one frame of output
 		//  by performing three steps:
+		frame_profiler.begin_frame();
 
 		{ //(1) process any events that are pending
+			FrameProfiler::CpuScope profile(FrameProfiler::CpuEvents);
 			static SDL_Event evt;
 			while (SDL_PollEvent(&evt) == 1) {
 				//handle resizing:
@@ -159,19 +338,20 @@ int main(int argc, char **argv) {
 					Mode::set_current(nullptr);
 					break;
 				} else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_PRINTSCREEN) {
-					// --- screenshot key ---
-					std::string filename = "screenshot.png";
-					std::cout << "Saving screenshot to '" << filename << "'." << std::endl;
-					glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
-					glReadBuffer(GL_FRONT);
-					int w,h;
-					SDL_GL_GetDrawableSize(window, &w, &h);
-					std::vector< glm::u8vec4 > data(w*h);
-					glReadPixels(0,0,w,h, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
-					for (auto &px : data) {
-						px.a = 0xff;
+					// --- screenshot key (shift: start/stop saving every frame) ---
+					if (evt.key.keysym.mod & KMOD_SHIFT) {
+						if (capture.sequence_running()) capture.stop_sequence();
+						else capture.start_sequence("frame-");
+					} else {
+						capture.screenshot("screenshot.png");
 					}
-					save_png(filename, glm::uvec2(w,h), data.data(), LowerLeftOrigin);
+				} else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F3) {
+					// --- frame time overlay key ---
+					frame_profiler.shown = !frame_profiler.shown;
+				} else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F4) {
+					// --- trace key: start tracing, or write out the recent trace ---
+					if (trace_enabled) trace_dump();
+					else trace_start("trace.json");
 				}
 			}
 			if (!Mode::current) break;
@@ -187,22 +367,40 @@ int main(int argc, char **argv) {
 			//lag to avoid spiral of death:
 			elapsed = std::min(0.1f, elapsed);
 
+			FrameProfiler::CpuScope profile(FrameProfiler::CpuUpdate);
 			Mode::current->update(elapsed);
 			if (!Mode::current) break;
 		}
 
 		{ //(3) call the current mode's "draw" function to produce output:
-		
+			FrameProfiler::CpuScope profile(FrameProfiler::CpuDraw);
 			Mode::current->draw(drawable_size);
+			frame_profiler.draw_overlay(drawable_size); //(if shown)
+		}
+
+		//Copy out the frame, if it is being saved:
+		capture.capture(drawable_size);
+
+		{ //Wait until the recently-drawn frame is shown before doing it all again:
+			FrameProfiler::CpuScope profile(FrameProfiler::CpuSwap);
+			TraceScope trace("SDL_GL_SwapWindow");
+			SDL_GL_SwapWindow(window);
 		}
 
-		//Wait until the recently-drawn frame is shown before doing it all again:
-		SDL_GL_SwapWindow(window);
+		static bool first_frame = true;
+		if (first_frame) {
+			first_frame = false;
+			startup_mark("first frame");
+			startup_report(); //(only if STARTUP_PROFILE is set)
+		}
 	}
 
 
 	//------------  teardown ------------
 
+	capture.finish(); //(writes out any frames still being saved)
+	trace_stop(); //(writes the trace, if tracing)
+
 	SDL_GL_DeleteContext(context);
 	context = 0;
 
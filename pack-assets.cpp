@@ -0,0 +1,104 @@
+//Bundles asset files into a single AssetPack (see AssetPack.hpp):
+//Usage:
+//  pack-assets <out.pack> <root> <asset> [<asset> ...]
+//Each asset is read from <root>/<asset> and stored under the name <asset>.
+//e.g., to make the game read its meshes and scenes from one file:
+//  scenes/pack-assets dist/data.pack dist snow.pnct snow.scene snow-globe.pnct snow-globe.scene
+//(while dist/data.pack exists, the game uses it instead of the loose files -- so rebuild or delete it after changing assets)
+
+#include "AssetPack.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+	if (argc < 4) {
+		std::cerr << "Usage:\n\t" << argv[0] << " <out.pack> <root> <asset> [<asset> ...]" << std::endl;
+		return 1;
+	}
+	std::string out_filename = argv[1];
+	std::string root = argv[2];
+	std::vector< std::string > asset_names(argv + 3, argv + argc);
+
+	//read assets:
+	std::vector< std::vector< char > > asset_data;
+	for (std::string const &name : asset_names) {
+		std::string path = root + "/" + name;
+		std::ifstream file(path, std::ios::binary);
+		if (!file) {
+			std::cerr << "Failed to open '" << path << "'" << std::endl;
+			return 1;
+		}
+		asset_data.emplace_back(std::istreambuf_iterator< char >(file), std::istreambuf_iterator< char >());
+	}
+
+	//directory, with at most half the slots used so probe sequences stay short:
+	uint32_t slot_count = 1;
+	while (slot_count < 2 * asset_names.size()) slot_count *= 2;
+
+	AssetPack::Header header;
+	std::memcpy(header.magic, "pak0", 4);
+	header.slot_count = slot_count;
+	header.asset_count = uint32_t(asset_names.size());
+
+	std::vector< char > names;
+	std::vector< AssetPack::Slot > slots(slot_count, AssetPack::Slot{0, 0, 0, 0, 0});
+
+	uint64_t at = sizeof(AssetPack::Header) + uint64_t(slot_count) * sizeof(AssetPack::Slot);
+	for (std::string const &name : asset_names) at += name.size();
+	auto align = [](uint64_t offset) {
+		return (offset + AssetPack::Alignment - 1) / AssetPack::Alignment * AssetPack::Alignment;
+	};
+
+	for (uint32_t a = 0; a < asset_names.size(); ++a) {
+		std::string const &name = asset_names[a];
+		AssetPack::Slot slot;
+		slot.hash = AssetPack::hash_name(name);
+		slot.name_begin = uint32_t(names.size());
+		names.insert(names.end(), name.begin(), name.end());
+		slot.name_end = uint32_t(names.size());
+		at = align(at);
+		slot.offset = at;
+		slot.size = asset_data[a].size();
+		at += slot.size;
+
+		uint32_t i = uint32_t(slot.hash) & (slot_count - 1);
+		while (slots[i].name_end != 0) {
+			AssetPack::Slot const &other = slots[i];
+			if (std::string(names.begin() + other.name_begin, names.begin() + other.name_end) == name) {
+				std::cerr << "Asset '" << name << "' is listed twice." << std::endl;
+				return 1;
+			}
+			i = (i + 1) & (slot_count - 1);
+		}
+		slots[i] = slot;
+	}
+	header.names_size = uint32_t(names.size());
+
+	{ //write pack:
+		std::ofstream file(out_filename, std::ios::binary);
+		file.write(reinterpret_cast< char const * >(&header), sizeof(header));
+		file.write(reinterpret_cast< char const * >(slots.data()), slots.size() * sizeof(AssetPack::Slot));
+		file.write(names.data(), names.size());
+		uint64_t written = sizeof(header) + slots.size() * sizeof(AssetPack::Slot) + names.size();
+		for (uint32_t a = 0; a < asset_names.size(); ++a) {
+			uint64_t offset = align(written);
+			std::vector< char > padding(size_t(offset - written), '\0');
+			file.write(padding.data(), padding.size());
+			file.write(asset_data[a].data(), asset_data[a].size());
+			written = offset + asset_data[a].size();
+		}
+		if (!file) {
+			std::cerr << "Failed to write '" << out_filename << "'" << std::endl;
+			return 1;
+		}
+		std::cout << "Wrote '" << out_filename << "': " << asset_names.size() << " assets, " << written << " bytes." << std::endl;
+	}
+
+	return 0;
+}
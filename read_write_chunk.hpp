@@ -1,15 +1,22 @@
 #pragma once
 
+#include "chunk_compression.hpp"
+
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <string>
 #include <vector>
 #include <stdexcept>
 #include <cassert>
+#include <utility>
 
 //helper function that reads an array of structures preceded by a simple header:
 //Expected format:
 // |ma|gi|c.|..| <-- four byte "magic number"
 // |sz|sz|sz|sz| <-- four byte (native endian) size
 // |TT...TT| * (sz/sizeof(TT)) <-- enough T structures to make up sz bytes
+//(the game's loaders read files in place with ChunkFile -- see ChunkFile.hpp -- instead of copying them into vectors)
 
 template< typename T >
 void read_chunk(std::istream &from, std::string const &magic, std::vector< T > *to_) {
@@ -40,6 +47,17 @@ void read_chunk(std::istream &from, std::string const &magic, std::vector< T > *
 	}
 }
 
+//helper function that checks whether the next chunk has a given magic number, without reading it:
+// (useful for optional chunks)
+inline bool peek_chunk(std::istream &from, std::string const &magic) {
+	assert(magic.size() == 4);
+	std::streampos at = from.tellg();
+	char header_magic[4] = {'\0', '\0', '\0', '\0'};
+	bool match = from.read(header_magic, 4) && std::string(header_magic, 4) == magic;
+	from.clear();
+	from.seekg(at);
+	return match;
+}
 
 //helper function to write a chunk of data in the same format as read_chunk:
 template< typename T >
@@ -63,3 +81,77 @@ void write_chunk(std::string const &magic, std::vector< T > const &from, std::os
 	to.write(reinterpret_cast< const char * >(&header), sizeof(header));
 	to.write(reinterpret_cast< const char * >(from.data()), from.size() * sizeof(T));
 }
+
+//Files may start with a 'toc0' chunk listing the other chunks, so readers can jump straight to the ones they want:
+// (ChunkFile uses it; read_chunk / peek_chunk don't know about it, so they can't read such files)
+struct ChunkTocEntry {
+	char magic[4];
+	uint32_t offset; //of the chunk's header, from the start of the file
+	uint32_t size; //of the chunk's data (same as in its header)
+};
+static_assert(sizeof(ChunkTocEntry) == 12, "toc entry is packed");
+
+//helper that collects chunks and then writes them after a 'toc0' chunk:
+// each chunk's data starts on a ChunkTocWriter::Alignment-byte boundary (which only readers that use the toc can skip)
+//
+// ChunkTocWriter chunks;
+// chunks.add("pnct", data);
+// chunks.add("str0", strings);
+// chunks.add_compressed("idx1", elements); //(needs chunk_compression.cpp)
+// chunks.write(&file);
+struct ChunkTocWriter {
+	enum : uint32_t { Alignment = 16 };
+
+	template< typename T >
+	void add(std::string const &magic, std::vector< T > const &from) {
+		assert(magic.size() == 4);
+		char const *begin = reinterpret_cast< char const * >(from.data());
+		chunks.emplace_back(magic, std::vector< char >(begin, begin + from.size() * sizeof(T)));
+	}
+
+	//add a chunk compressed with compress_chunk_payload (see chunk_compression.hpp), if that saves at least 1/8 of its size:
+	// (ChunkFile decompresses it transparently; 'stride' tells the byte-shuffle filter how big elements are)
+	template< typename T >
+	void add_compressed(std::string const &magic, std::vector< T > const &from, uint32_t stride = sizeof(T)) {
+		assert(magic.size() == 4 && !(uint8_t(magic[0]) & CompressedChunkFlag));
+		size_t raw_size = from.size() * sizeof(T);
+		std::vector< char > compressed = compress_chunk_payload(reinterpret_cast< char const * >(from.data()), raw_size, stride);
+		if (compressed.size() > raw_size - raw_size / 8) {
+			add(magic, from);
+			return;
+		}
+		std::string flagged = magic;
+		flagged[0] = char(uint8_t(magic[0]) | CompressedChunkFlag);
+		chunks.emplace_back(flagged, std::move(compressed));
+	}
+
+	void write(std::ostream *to_) const {
+		assert(to_);
+		auto &to = *to_;
+
+		std::vector< ChunkTocEntry > toc;
+		toc.reserve(chunks.size());
+		uint64_t at = 8 + chunks.size() * sizeof(ChunkTocEntry); //(end of the toc chunk)
+		for (auto const &chunk : chunks) {
+			at += (Alignment - (at + 8) % Alignment) % Alignment; //pad so data (after the 8-byte header) is aligned
+			if (at + 8 + chunk.second.size() > 0xffffffffu) throw std::runtime_error("Chunk file too large for a toc");
+			ChunkTocEntry entry;
+			std::copy(chunk.first.begin(), chunk.first.end(), entry.magic);
+			entry.offset = uint32_t(at);
+			entry.size = uint32_t(chunk.second.size());
+			toc.emplace_back(entry);
+			at += 8 + chunk.second.size();
+		}
+
+		write_chunk("toc0", toc, &to);
+		uint64_t written = 8 + toc.size() * sizeof(ChunkTocEntry);
+		for (size_t i = 0; i < chunks.size(); ++i) {
+			std::vector< char > padding(toc[i].offset - written, '\0');
+			to.write(padding.data(), padding.size());
+			write_chunk(chunks[i].first, chunks[i].second, &to);
+			written = toc[i].offset + 8 + chunks[i].second.size();
+		}
+	}
+
+	std::vector< std::pair< std::string, std::vector< char > > > chunks;
+};